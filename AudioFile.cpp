@@ -0,0 +1,287 @@
+/*
+
+Memory mapped WAV and AU file reader.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AudioFile.hpp"
+
+#include <algorithm>                    // std::min
+#include <cctype>                       // tolower
+#include <cstring>                      // memcmp
+#include <stdexcept>                    // std::runtime_error
+
+#include <fcntl.h>                      // open
+#include <sys/mman.h>                   // mmap
+#include <sys/stat.h>                   // fstat
+#include <unistd.h>                     // close
+
+#include "SampleFormat.hpp"             // Pcm16le
+
+namespace dtmf
+{
+
+static uint32_t get_le32( const uint8_t * p )
+{
+    return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( static_cast<uint32_t>( p[3] ) << 24 );
+}
+
+static uint16_t get_le16( const uint8_t * p )
+{
+    return p[0] | ( p[1] << 8 );
+}
+
+static uint32_t get_be32( const uint8_t * p )
+{
+    return ( static_cast<uint32_t>( p[0] ) << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3];
+}
+
+static bool has_suffix( const std::string & s, const std::string & suffix )
+{
+    if( s.size() < suffix.size() )
+        return false;
+
+    for( size_t ii = 0; ii < suffix.size(); ++ii )
+    {
+        if( tolower( s[s.size() - suffix.size() + ii] ) != suffix[ii] )
+            return false;
+    }
+
+    return true;
+}
+
+AudioFile::AudioFile( const std::string & filename ):
+        map_( nullptr ),
+        map_size_( 0 ),
+        data_( nullptr ),
+        num_samples_( 0 ),
+        block_align_( 1 ),
+        encoding_( encoding_e::PCM16_LE ),
+        sampling_rate_( 0 )
+{
+    int fd = open( filename.c_str(), O_RDONLY );
+
+    if( fd == -1 )
+        throw std::runtime_error( "cannot open " + filename );
+
+    struct stat st;
+
+    if( fstat( fd, & st ) == -1 || st.st_size < 24 )
+    {
+        close( fd );
+        throw std::runtime_error( "file is too small: " + filename );
+    }
+
+    map_size_   = st.st_size;
+
+    void * addr = mmap( nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+    close( fd );
+
+    if( addr == MAP_FAILED )
+        throw std::runtime_error( "cannot map " + filename );
+
+    map_    = static_cast<const uint8_t*>( addr );
+
+    try
+    {
+        if( memcmp( map_, "RIFF", 4 ) == 0 )
+            parse_wav( filename );
+        else if( memcmp( map_, ".snd", 4 ) == 0 )
+            parse_au( filename );
+        else
+            throw std::runtime_error( "unknown format: " + filename );
+    }
+    catch( ... )
+    {
+        munmap( const_cast<uint8_t*>( map_ ), map_size_ );
+        throw;
+    }
+}
+
+AudioFile::~AudioFile()
+{
+    munmap( const_cast<uint8_t*>( map_ ), map_size_ );
+}
+
+void AudioFile::parse_wav( const std::string & filename )
+{
+    if( memcmp( map_ + 8, "WAVE", 4 ) != 0 )
+        throw std::runtime_error( "not a WAVE file: " + filename );
+
+    const uint8_t   * fmt = nullptr;
+    uint32_t        fmt_size = 0;
+    size_t          pos = 12;
+
+    while( pos + 8 <= map_size_ )
+    {
+        uint32_t chunk_size = get_le32( map_ + pos + 4 );
+
+        if( memcmp( map_ + pos, "fmt ", 4 ) == 0 && chunk_size >= 16 && pos + 8 + chunk_size <= map_size_ )
+        {
+            fmt         = map_ + pos + 8;
+            fmt_size    = chunk_size;
+        }
+        else if( memcmp( map_ + pos, "data", 4 ) == 0 )
+        {
+            if( fmt == nullptr )
+                break;
+
+            uint16_t format     = get_le16( fmt );
+            uint16_t channels   = get_le16( fmt + 2 );
+            uint16_t bits       = get_le16( fmt + 14 );
+
+            // WAVE_FORMAT_EXTENSIBLE, the format is in the sub-format GUID
+            if( format == 0xFFFE && fmt_size >= 40 )
+                format = get_le16( fmt + 24 );
+
+            if( format == 1 && bits == 16 )
+                encoding_ = encoding_e::PCM16_LE;
+            else if( format == 1 && bits == 8 )
+                encoding_ = encoding_e::PCM8_UNSIGNED;
+            else if( format == 6 )
+                encoding_ = encoding_e::ALAW;
+            else if( format == 7 )
+                encoding_ = encoding_e::ULAW;
+            else
+                throw std::runtime_error( "unsupported WAV encoding: " + filename );
+
+            sampling_rate_  = get_le32( fmt + 4 );
+            block_align_    = get_le16( fmt + 12 );
+
+            // the samples are read at the first byte of each block
+            if( block_align_ == 0 || block_align_ != bits / 8 * channels )
+                throw std::runtime_error( "invalid block align: " + filename );
+
+            data_           = map_ + pos + 8;
+
+            size_t size     = std::min<size_t>( chunk_size, map_size_ - ( pos + 8 ) );
+
+            num_samples_    = static_cast<uint32_t>( size / block_align_ );
+
+            return;
+        }
+
+        // chunks are padded to an even size
+        pos += 8 + chunk_size + ( chunk_size & 1 );
+    }
+
+    throw std::runtime_error( "no audio data: " + filename );
+}
+
+void AudioFile::parse_au( const std::string & filename )
+{
+    uint32_t offset     = get_be32( map_ + 4 );
+    uint32_t size       = get_be32( map_ + 8 );
+    uint32_t encoding   = get_be32( map_ + 12 );
+    uint32_t channels   = get_be32( map_ + 20 );
+
+    if( offset > map_size_ || channels == 0 )
+        throw std::runtime_error( "invalid AU header: " + filename );
+
+    uint32_t bytes      = 1;
+
+    switch( encoding )
+    {
+    case 1:
+        encoding_   = encoding_e::ULAW;
+        break;
+    case 2:
+        encoding_   = encoding_e::PCM8_SIGNED;
+        break;
+    case 3:
+        encoding_   = encoding_e::PCM16_BE;
+        bytes       = 2;
+        break;
+    case 27:
+        encoding_   = encoding_e::ALAW;
+        break;
+    default:
+        throw std::runtime_error( "unsupported AU encoding: " + filename );
+    }
+
+    // 0xffffffff - unknown size
+    if( size == 0xffffffff || size > map_size_ - offset )
+        size = map_size_ - offset;
+
+    sampling_rate_  = get_be32( map_ + 16 );
+    block_align_    = bytes * channels;
+    data_           = map_ + offset;
+    num_samples_    = size / block_align_;
+}
+
+int32_t AudioFile::get_sampling_rate() const
+{
+    return sampling_rate_;
+}
+
+uint32_t AudioFile::get_num_samples() const
+{
+    return num_samples_;
+}
+
+void AudioFile::prefetch() const
+{
+    madvise( const_cast<uint8_t*>( map_ ), map_size_, MADV_WILLNEED );
+    madvise( const_cast<uint8_t*>( map_ ), map_size_, MADV_SEQUENTIAL );
+}
+
+uint32_t AudioFile::read( uint32_t pos, int16_t * samples, uint32_t size ) const
+{
+    if( pos >= num_samples_ )
+        return 0;
+
+    if( size > num_samples_ - pos )
+        size = num_samples_ - pos;
+
+    const uint8_t * p = data_ + static_cast<size_t>( pos ) * block_align_;
+
+    for( uint32_t ii = 0; ii < size; ++ii, p += block_align_ )
+    {
+        switch( encoding_ )
+        {
+        case encoding_e::PCM8_UNSIGNED:
+            samples[ii] = Pcm8Unsigned::decode( p );
+            break;
+        case encoding_e::PCM8_SIGNED:
+            samples[ii] = Pcm8Signed::decode( p );
+            break;
+        case encoding_e::PCM16_LE:
+            samples[ii] = Pcm16le::decode( p );
+            break;
+        case encoding_e::PCM16_BE:
+            samples[ii] = Pcm16be::decode( p );
+            break;
+        case encoding_e::ULAW:
+            samples[ii] = Ulaw::decode( p );
+            break;
+        case encoding_e::ALAW:
+            samples[ii] = Alaw::decode( p );
+            break;
+        }
+    }
+
+    return size;
+}
+
+bool AudioFile::is_supported( const std::string & filename )
+{
+    return has_suffix( filename, ".wav" ) || has_suffix( filename, ".au" );
+}
+
+} // namespace dtmf
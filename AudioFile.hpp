@@ -0,0 +1,87 @@
+/*
+
+Memory mapped WAV and AU file reader.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_AUDIO_FILE
+#define DTMF_AUDIO_FILE
+
+#include <cstdint>      // int16_t
+#include <string>       // std::string
+
+namespace dtmf
+{
+
+// Maps a WAV (PCM 8/16 bit, A-law, mu-law) or AU (8/16 bit linear, mu-law)
+// file and decodes the first channel into 16-bit samples.
+
+class AudioFile
+{
+public:
+    enum class encoding_e
+    {
+        PCM8_UNSIGNED,
+        PCM8_SIGNED,
+        PCM16_LE,
+        PCM16_BE,
+        ULAW,
+        ALAW,
+    };
+
+    // throws std::runtime_error
+    AudioFile( const std::string & filename );
+    ~AudioFile();
+
+    int32_t get_sampling_rate() const;
+
+    // number of samples per channel
+    uint32_t get_num_samples() const;
+
+    // Asks the kernel to read the whole file asynchronously.
+    void prefetch() const;
+
+    // Decodes up to size samples of the first channel starting at pos,
+    // returns the number of decoded samples.
+    uint32_t read( uint32_t pos, int16_t * samples, uint32_t size ) const;
+
+    // true for .wav and .au files
+    static bool is_supported( const std::string & filename );
+
+private:
+    AudioFile( const AudioFile & );
+    AudioFile & operator=( const AudioFile & );
+
+    void parse_wav( const std::string & filename );
+    void parse_au( const std::string & filename );
+
+private:
+    const uint8_t   * map_;
+    size_t          map_size_;
+
+    const uint8_t   * data_;
+    uint32_t        num_samples_;
+    uint32_t        block_align_;   // bytes per sample of all channels
+
+    encoding_e      encoding_;
+    int32_t         sampling_rate_;
+};
+
+} // namespace dtmf
+
+#endif // DTMF_AUDIO_FILE
@@ -0,0 +1,298 @@
+/*
+
+Call progress tone classifier.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CallProgressClassifier.hpp"
+
+#include "IDtmfDetectorCallback.hpp"    // IDtmfDetectorCallback
+
+namespace dtmf
+{
+
+// Indices of the magnitudes passed to on_frame(), the bins of
+// get_frequencies() follow the DTMF ones.
+// The guard bins lie between the tones and estimate the noise floor.
+enum
+{
+    BIN_350 = IToneClassifier::DTMF_BIN_NUMBER,
+    BIN_440,
+    BIN_480,
+    BIN_620,
+    BIN_SIT_1,
+    BIN_SIT_2,
+    BIN_SIT_3,
+    BIN_CNG,
+    BIN_CED,
+    BIN_GUARD_0,
+    BIN_GUARD_1,
+    BIN_GUARD_2,
+    BIN_GUARD_3,
+    BIN_NUMBER
+};
+
+static const double FREQUENCIES[BIN_NUMBER - BIN_350] =
+{
+        350.0,
+        440.0,
+        480.0,
+        620.0,
+        950.0,      // SIT 913.8 / 985.2
+        1400.0,     // SIT 1370.6 / 1428.5
+        1776.7,     // SIT
+        1100.0,     // fax CNG
+        2100.0,     // fax CED
+        750.0,
+        1250.0,
+        1600.0,
+        2500.0
+};
+
+// Ratio of a tone bin to the average guard bin for the tone to be present.
+static const int32_t PRESENT_RATIO      = 10;
+// Ratio of a single tone bin to every other tone bin.
+static const int32_t DOMINANT_RATIO     = 4;
+
+// Durations in milliseconds.
+static const uint32_t BUSY_MIN          = 350;
+static const uint32_t BUSY_MAX          = 650;
+static const uint32_t RINGBACK_MIN      = 800;
+static const uint32_t SIT_MIN           = 200;
+static const uint32_t SIT_MAX           = 450;
+static const uint32_t FAX_CNG_MIN       = 400;
+static const uint32_t FAX_CED_MIN       = 1000;
+// Runs shorter than that are treated as transitions between tones.
+static const uint32_t GLITCH_MAX        = 30;
+// Number of frames needed to start a new run.
+static const uint32_t DEBOUNCE_FRAMES   = 2;
+
+CallProgressClassifier::CallProgressClassifier():
+        frame_duration_( 0 ),
+        label_( label_e::SILENCE ),
+        run_frames_( 0 ),
+        pending_label_( label_e::SILENCE ),
+        pending_frames_( 0 ),
+        busy_cycles_( 0 ),
+        busy_off_frames_( 0 ),
+        sit_stage_( 0 )
+{
+}
+
+void CallProgressClassifier::init( int32_t sampling_rate, uint32_t frame_size )
+{
+    frame_duration_ = static_cast<uint32_t>( 1000000ULL * frame_size / sampling_rate );
+}
+
+std::vector<double> CallProgressClassifier::get_frequencies() const
+{
+    return std::vector<double>( FREQUENCIES, FREQUENCIES + BIN_NUMBER - BIN_350 );
+}
+
+void CallProgressClassifier::on_frame( const int32_t * magnitudes, int32_t, IDtmfDetectorCallback * callback )
+{
+    update( classify( magnitudes ), callback );
+}
+
+void CallProgressClassifier::on_silence( IDtmfDetectorCallback * callback )
+{
+    update( label_e::SILENCE, callback );
+}
+
+CallProgressClassifier::label_e CallProgressClassifier::classify( const int32_t * magnitudes ) const
+{
+    int32_t noise = ( magnitudes[BIN_GUARD_0] + magnitudes[BIN_GUARD_1] + magnitudes[BIN_GUARD_2] + magnitudes[BIN_GUARD_3] ) >> 2;
+
+    if( noise <= 0 )
+        noise = 1;
+
+    // indexed by bin - BIN_350
+    bool present[BIN_GUARD_0 - BIN_350];
+
+    for( unsigned ii = BIN_350; ii < BIN_GUARD_0; ++ii )
+        present[ii - BIN_350] = magnitudes[ii] / noise >= PRESENT_RATIO;
+
+    // single frequency tones must clearly dominate all other tone bins
+    static const unsigned SINGLE[] = { BIN_CED, BIN_CNG, BIN_SIT_3, BIN_SIT_2, BIN_SIT_1 };
+    static const label_e  SINGLE_LABEL[] = { label_e::FAX_CED, label_e::FAX_CNG, label_e::SIT_3, label_e::SIT_2, label_e::SIT_1 };
+
+    for( unsigned ii = 0; ii < sizeof( SINGLE ) / sizeof( SINGLE[0] ); ++ii )
+    {
+        unsigned bin = SINGLE[ii];
+
+        if( present[bin - BIN_350] == false )
+            continue;
+
+        bool is_dominant = true;
+
+        for( unsigned jj = BIN_350; jj < BIN_GUARD_0 && is_dominant; ++jj )
+        {
+            if( jj != bin && magnitudes[jj] * DOMINANT_RATIO > magnitudes[bin] )
+                is_dominant = false;
+        }
+
+        if( is_dominant )
+            return SINGLE_LABEL[ii];
+    }
+
+    // both components of a dual tone have a similar level
+    bool is_620_comparable = present[BIN_620 - BIN_350] &&
+            magnitudes[BIN_620] * DOMINANT_RATIO >= magnitudes[BIN_480] &&
+            magnitudes[BIN_480] * DOMINANT_RATIO >= magnitudes[BIN_620];
+
+    if( present[BIN_480 - BIN_350] && is_620_comparable )
+        return label_e::BUSY;
+
+    // 440 and 480 are too close to be resolved in one frame, so the
+    // ringback is told apart from the dial tone (350 + 440) by the 350 bin
+    if( present[BIN_440 - BIN_350] && present[BIN_480 - BIN_350] && is_620_comparable == false &&
+            magnitudes[BIN_350] * DOMINANT_RATIO < magnitudes[BIN_440] )
+        return label_e::RINGBACK;
+
+    return label_e::OTHER;
+}
+
+uint32_t CallProgressClassifier::get_duration( uint32_t frames ) const
+{
+    return static_cast<uint32_t>( static_cast<uint64_t>( frames ) * frame_duration_ / 1000 );
+}
+
+void CallProgressClassifier::update( label_e label, IDtmfDetectorCallback * callback )
+{
+    // a single deviating frame (e.g. a beat minimum of the ringback) is
+    // counted as a part of the current run
+    if( label == label_ )
+    {
+        pending_frames_ = 0;
+    }
+    else if( pending_frames_ == 0 || label != pending_label_ )
+    {
+        pending_label_  = label;
+        pending_frames_ = 1;
+    }
+    else
+    {
+        ++pending_frames_;
+    }
+
+    if( label != label_ && pending_frames_ >= DEBOUNCE_FRAMES )
+    {
+        // the pending frames were counted as the old run, move them
+        run_frames_ -= ( pending_frames_ - 1 );
+
+        if( label_ == label_e::BUSY )
+            busy_off_frames_ = 0;
+        else
+            busy_off_frames_ += run_frames_;
+
+        end_run( label_, get_duration( run_frames_ ), callback );
+
+        // a new busy on-period must follow a pause of the right length
+        if( label == label_e::BUSY && busy_cycles_ > 0 )
+        {
+            uint32_t pause = get_duration( busy_off_frames_ );
+
+            if( pause < BUSY_MIN || pause > BUSY_MAX )
+                busy_cycles_ = 0;
+        }
+
+        label_          = label;
+        run_frames_     = pending_frames_ - 1;
+        pending_frames_ = 0;
+    }
+
+    uint32_t prev_duration  = get_duration( run_frames_ );
+
+    ++run_frames_;
+
+    uint32_t duration       = get_duration( run_frames_ );
+
+    uint32_t threshold      = 0;
+    bool     has_cp_tone    = true;
+    cp_tone_e cp_tone       = cp_tone_e::BUSY;
+
+    switch( label_ )
+    {
+    case label_e::RINGBACK:
+        threshold   = RINGBACK_MIN;
+        cp_tone     = cp_tone_e::RINGBACK;
+        break;
+    case label_e::FAX_CNG:
+        threshold   = FAX_CNG_MIN;
+        cp_tone     = cp_tone_e::FAX_CNG;
+        break;
+    case label_e::FAX_CED:
+        threshold   = FAX_CED_MIN;
+        cp_tone     = cp_tone_e::FAX_CED;
+        break;
+    case label_e::SIT_3:
+        threshold   = SIT_MIN;
+        cp_tone     = cp_tone_e::SIT;
+        has_cp_tone = ( sit_stage_ == 2 );
+        break;
+    default:
+        has_cp_tone = false;
+        break;
+    }
+
+    // report once per run, when the run becomes long enough
+    if( has_cp_tone && prev_duration < threshold && duration >= threshold )
+    {
+        if( label_ == label_e::SIT_3 )
+            sit_stage_ = 0;
+
+        if( callback )
+            callback->on_call_progress( cp_tone );
+    }
+}
+
+void CallProgressClassifier::end_run( label_e label, uint32_t duration, IDtmfDetectorCallback * callback )
+{
+    switch( label )
+    {
+    case label_e::BUSY:
+        if( duration >= BUSY_MIN && duration <= BUSY_MAX )
+        {
+            ++busy_cycles_;
+
+            // reported once, at the end of the second on-period
+            if( busy_cycles_ == 2 && callback )
+                callback->on_call_progress( cp_tone_e::BUSY );
+        }
+        else
+        {
+            busy_cycles_ = 0;
+        }
+        break;
+
+    case label_e::SIT_1:
+        sit_stage_  = ( duration >= SIT_MIN && duration <= SIT_MAX ) ? 1 : 0;
+        break;
+
+    case label_e::SIT_2:
+        sit_stage_  = ( sit_stage_ == 1 && duration >= SIT_MIN && duration <= SIT_MAX ) ? 2 : 0;
+        break;
+
+    default:
+        if( duration > GLITCH_MAX )
+            sit_stage_ = 0;
+        break;
+    }
+}
+
+} // namespace dtmf
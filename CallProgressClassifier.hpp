@@ -0,0 +1,94 @@
+/*
+
+Call progress tone classifier.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_CALL_PROGRESS_CLASSIFIER
+#define DTMF_CALL_PROGRESS_CLASSIFIER
+
+#include "IToneClassifier.hpp"          // IToneClassifier
+
+namespace dtmf
+{
+
+// Detects busy and ringback (North American precise tone plan),
+// special information tones and fax CNG/CED tones.
+
+class CallProgressClassifier: public IToneClassifier
+{
+public:
+    CallProgressClassifier();
+
+    void init( int32_t sampling_rate, uint32_t frame_size );
+
+    std::vector<double> get_frequencies() const;
+
+    void on_frame( const int32_t * magnitudes, int32_t power, IDtmfDetectorCallback * callback );
+
+    void on_silence( IDtmfDetectorCallback * callback );
+
+private:
+
+    // tone present in a single frame
+    enum class label_e
+    {
+        SILENCE,
+        OTHER,
+        BUSY,
+        RINGBACK,
+        SIT_1,
+        SIT_2,
+        SIT_3,
+        FAX_CNG,
+        FAX_CED,
+    };
+
+    label_e classify( const int32_t * magnitudes ) const;
+
+    void update( label_e label, IDtmfDetectorCallback * callback );
+
+    // called when a run of equal labels is over
+    void end_run( label_e label, uint32_t duration, IDtmfDetectorCallback * callback );
+
+    uint32_t get_duration( uint32_t frames ) const;
+
+private:
+
+    // frame duration in microseconds
+    uint32_t    frame_duration_;
+
+    label_e     label_;
+    uint32_t    run_frames_;
+
+    // label that differs from label_, not yet long enough to start a run
+    label_e     pending_label_;
+    uint32_t    pending_frames_;
+
+    // number of busy on-periods with a valid cadence
+    uint32_t    busy_cycles_;
+    // number of frames between the last busy on-period and the current run
+    uint32_t    busy_off_frames_;
+
+    // number of SIT segments seen in the right order
+    uint32_t    sit_stage_;
+};
+
+} // namespace dtmf
+
+#endif // DTMF_CALL_PROGRESS_CLASSIFIER
@@ -6,11 +6,14 @@
  * All rights reserved.
  */
 
+#include <algorithm>                    // std::copy
 #include <cassert>
+#include <cmath>                        // std::cos
 #include <stdexcept>                    // std::invalid_argument
 #include "DtmfDetector.hpp"
 
 #include "IDtmfDetectorCallback.hpp"    // IDtmfDetectorCallback
+#include "IToneClassifier.hpp"          // IToneClassifier
 
 #if DEBUG
 #include <cstdio>
@@ -40,13 +43,16 @@ static inline int32_t MPY48SR( int16_t o16, int32_t o32 )
 // Magnitude1       Detected magnitude of the second frequency.
 // COUNT            The number of elements in arraySamples.  Always equal to
 //                  SAMPLES in practice.
+// SHIFT            Right shift of the state before the magnitude calculation,
+//                  see get_goertzel_shift.
 static void goertzel_filter(
         int16_t         Koeff0,
         int16_t         Koeff1,
         const int16_t   arraySamples[],
         int32_t         *Magnitude0,
         int32_t         *Magnitude1,
-        uint32_t        COUNT )
+        uint32_t        COUNT,
+        uint32_t        SHIFT )
 {
     int32_t Temp0, Temp1;
     uint16_t ii;
@@ -70,9 +76,8 @@ static void goertzel_filter(
 
     // Magnitude: prev_prev**prev_prev + prev*prev - coeff*prev*prev_prev
 
-    // TODO: what does shifting by 10 bits to the right achieve?  Probably to
-    // make room for the magnitude calculations.
-    Vk1_0 >>= 10, Vk1_1 >>= 10, Vk2_0 >>= 10, Vk2_1 >>= 10;
+    // The state is shifted to fit into 16 bits for the magnitude calculations.
+    Vk1_0 >>= SHIFT, Vk1_1 >>= SHIFT, Vk2_0 >>= SHIFT, Vk2_1 >>= SHIFT;
     Temp0 = MPY48SR( Koeff0, Vk1_0 << 1 ), Temp1 = MPY48SR( Koeff1, Vk1_1 << 1 );
     Temp0 = (int16_t)Temp0 * (int16_t)Vk2_0, Temp1 = (int16_t)Temp1 * (int16_t)Vk2_1;
     Temp0 = (int16_t)Vk1_0 * (int16_t)Vk1_0 + (int16_t)Vk2_0 * (int16_t)Vk2_0 - Temp0;
@@ -81,8 +86,52 @@ static void goertzel_filter(
     return;
 }
 
-// This is a GSM function, for concrete processors she may be replaced
-// for same processor's optimized function (norm_l)
+// The Goertzel algorithm with 64-bit state, used for the bins of the
+// classifiers.  goertzel_filter keeps its state in 16 bits after the
+// final shift, which overflows for frequencies below the DTMF ones
+// (e.g. 440 Hz at 44.1 KHz).
+//
+// The magnitude is scaled down by 2^(2 * SHIFT), the same as the
+// magnitudes of goertzel_filter, so that they can be compared.
+static void goertzel_filter_wide(
+        int16_t         Koeff,
+        const int16_t   arraySamples[],
+        int32_t         *Magnitude,
+        uint32_t        COUNT,
+        uint32_t        SHIFT )
+{
+    int64_t Vk1 = 0, Vk2 = 0;
+
+    for( uint32_t ii = 0; ii < COUNT; ++ii )
+    {
+        int64_t Temp = ( ( Koeff * Vk1 ) >> 14 ) - Vk2 + arraySamples[ii];
+        Vk2 = Vk1;
+        Vk1 = Temp;
+    }
+
+    int64_t Power = Vk1 * Vk1 + Vk2 * Vk2 - ( ( Koeff * Vk1 ) >> 14 ) * Vk2;
+
+    Power >>= 2 * SHIFT;
+
+    *Magnitude = ( Power > INT32_MAX ) ? INT32_MAX : static_cast<int32_t>( Power );
+}
+
+// Right shift of the Goertzel state in goertzel_filter.  The state grows
+// up to COUNT / ( 2 * sin( w ) ) times the amplitude, the most at the
+// lowest DTMF frequency, and must stay below 2^14 after the shift for
+// a full-scale input.  10 for the default frame sizes of 8 and 16 KHz.
+static uint32_t get_goertzel_shift( uint32_t count, int32_t sampling_rate )
+{
+    double gain = 32768.0 * count / ( 2 * std::sin( 2 * M_PI * 697.0 / sampling_rate ) );
+
+    uint32_t shift = 10;
+
+    while( gain / ( 1 << shift ) >= ( 1 << 14 ) )
+        ++shift;
+
+    return shift;
+}
+
 // This is a GSM function, for concrete processors she may be replaced
 // for same processor's optimized function (norm_l)
 //
@@ -118,6 +167,9 @@ static inline int16_t norm_l( int32_t L_var1 )
     return ( var_out );
 }
 
+// Shortest DTMF tone to be detected, microseconds.
+static const uint32_t MIN_TONE_US = 40000;
+
 const unsigned DtmfDetector::COEFF_NUMBER;
 // These frequencies are slightly different to what is in the generator.
 // More importantly, they are also different to what is described at:
@@ -189,47 +241,189 @@ const int16_t DtmfDetector::CONSTANTS_44_1KHz[COEFF_NUMBER] =
         29283
 };
 
-int32_t DtmfDetector::power_threshold_ = 328;
-int32_t DtmfDetector::dial_tones_to_ohers_tones_ = 16;
-int32_t DtmfDetector::dial_tones_to_ohers_dial_tones_ = 6;
+//--------------------------------------------------------------------
+DtmfDetector::Profile::Profile(
+        int32_t sampling_rate ) :
+        sampling_rate( sampling_rate ),
+        frame_size( get_frame_size( sampling_rate ) ),
+        power_threshold( 328 ),
+        dial_tones_to_others_tones( 16 ),
+        dial_tones_to_others_dial_tones( 6 )
+{
+}
 //--------------------------------------------------------------------
 DtmfDetector::DtmfDetector(
         int32_t sampling_rate ) :
         callback_( nullptr ),
-        CONSTANTS( nullptr )
+        own_work_area_( nullptr ),
+        CONSTANTS( nullptr ),
+        sampling_rate_( sampling_rate )
+{
+    uint32_t size = get_work_area_size( sampling_rate );
+
+    if( size == 0 )
+    {
+        throw std::invalid_argument( "unsupported sampling rate" );
+    }
+
+    own_work_area_  = new int16_t[size];
+
+    init( Profile( sampling_rate ), own_work_area_ );
+}
+//--------------------------------------------------------------------
+DtmfDetector::DtmfDetector(
+        int32_t sampling_rate,
+        int16_t * work_area ) :
+        callback_( nullptr ),
+        own_work_area_( nullptr ),
+        CONSTANTS( nullptr ),
+        sampling_rate_( sampling_rate )
+{
+    if( get_work_area_size( sampling_rate ) == 0 )
+    {
+        throw std::invalid_argument( "unsupported sampling rate" );
+    }
+
+    init( Profile( sampling_rate ), work_area );
+}
+//--------------------------------------------------------------------
+DtmfDetector::DtmfDetector(
+        const Profile & profile ) :
+        callback_( nullptr ),
+        own_work_area_( nullptr ),
+        CONSTANTS( nullptr ),
+        sampling_rate_( profile.sampling_rate )
+{
+    if( get_frame_size( profile.sampling_rate ) == 0 )
+    {
+        throw std::invalid_argument( "unsupported sampling rate" );
+    }
+
+    // from half to twice the default frame: a frame must hold a few
+    // periods of the lowest frequency
+    if( profile.frame_size < get_frame_size( profile.sampling_rate ) / 2 ||
+            profile.frame_size > get_max_frame_size( profile.sampling_rate ) )
+    {
+        throw std::invalid_argument( "frame size out of range" );
+    }
+
+    if( profile.power_threshold < 0 || profile.dial_tones_to_others_tones <= 0 || profile.dial_tones_to_others_dial_tones <= 0 )
+    {
+        throw std::invalid_argument( "threshold out of range" );
+    }
+
+    own_work_area_  = new int16_t[2 * profile.frame_size];
+
+    init( profile, own_work_area_ );
+}
+//---------------------------------------------------------------------
+DtmfDetector::~DtmfDetector()
+{
+    delete[] own_work_area_;
+}
+
+uint32_t DtmfDetector::get_frame_size( int32_t sampling_rate )
 {
+    if( sampling_rate == 44100 )
+        return 512;
+    else if( sampling_rate == 16000 )
+        return 204;
+    else if( sampling_rate == 8000 )
+        return 102;
+
+    return 0;
+}
+
+uint32_t DtmfDetector::get_work_area_size( int32_t sampling_rate )
+{
+    // frame_buffer_ and internal_array_
+    return 2 * get_frame_size( sampling_rate );
+}
+
+uint32_t DtmfDetector::get_max_frame_size( int32_t sampling_rate )
+{
+    return 2 * get_frame_size( sampling_rate );
+}
+
+const DtmfDetector::Profile & DtmfDetector::get_profile() const
+{
+    return profile_;
+}
+
+void DtmfDetector::init( const Profile & profile, int16_t * work_area )
+{
+    int32_t sampling_rate = profile.sampling_rate;
+
+    profile_                        = profile;
+    power_threshold_                = profile.power_threshold;
+    dial_tones_to_ohers_tones_      = profile.dial_tones_to_others_tones;
+    dial_tones_to_ohers_dial_tones_ = profile.dial_tones_to_others_dial_tones;
+
     if( sampling_rate == 44100 )
     {
         CONSTANTS   = CONSTANTS_44_1KHz;
-        SAMPLES     = 512;
     }
     else if( sampling_rate == 16000 )
     {
         CONSTANTS   = CONSTANTS_16KHz;
-        SAMPLES     = 204;
-    }
-    else if( sampling_rate == 8000 )
-    {
-        CONSTANTS   = CONSTANTS_8KHz;
-        SAMPLES     = 102;
     }
     else
     {
-        throw std::invalid_argument( "unsupported sampling rate" );
+        CONSTANTS   = CONSTANTS_8KHz;
     }
 
+    SAMPLES     = profile.frame_size;
+
     //
-    // This array is padded to keep the last batch, which is smaller
-    // than SAMPLES, from the previous call to detect_dtmf.
+    // frame_buffer_ keeps the last batch, which is smaller
+    // than SAMPLES, from the previous call to process.
     //
-    internal_array_     = new int16_t[SAMPLES];
+    frame_buffer_       = work_area;
+    internal_array_     = work_area + SAMPLES;
+    buffered_           = 0;
+    buffered_energy_    = 0;
+    frame_position_     = 0;
     prev_dial_button_   = tone_e::TONE_0;
     prev_tone_type_     = tone_type_e::SILENCE;
-}
-//---------------------------------------------------------------------
-DtmfDetector::~DtmfDetector()
-{
-    delete[] internal_array_;
+
+    tier_               = tier_e::FULL;
+    silent_frames_      = 0;
+    idle_after_         = 2 * sampling_rate / SAMPLES;
+    no_tone_frames_     = 0;
+    sparse_after_       = sampling_rate / SAMPLES;
+    skip_phase_         = 0;
+
+    // A tone not aligned to the frames fully covers one frame less than
+    // fit into it, one frame of each sparse_period_ is analysed so that
+    // a fully covered frame is never skipped.  Long frames (e.g. more
+    // than 13.3 ms) give a period of 1, i.e. nothing is skipped.
+    uint32_t frame_us   = static_cast<uint32_t>( 1000000ULL * SAMPLES / sampling_rate );
+
+    sparse_period_      = MIN_TONE_US / frame_us;
+    sparse_period_      = ( sparse_period_ > 2 ) ? sparse_period_ - 1 : 1;
+    last_power_         = 0;
+
+    shift_              = get_goertzel_shift( SAMPLES, sampling_rate );
+    decimated_shift_    = get_goertzel_shift( SAMPLES / 2, sampling_rate / 2 );
+
+    // 8 KHz is the lowest rate which contains all DTMF frequencies
+    // and their harmonics, so it cannot be decimated
+    can_decimate_       = ( sampling_rate > 8000 );
+
+    if( sampling_rate == 16000 )
+    {
+        std::copy( CONSTANTS_8KHz, CONSTANTS_8KHz + COEFF_NUMBER, decimated_constants_ );
+    }
+    else
+    {
+        static const double FREQ[COEFF_NUMBER / 2] = { 697.0, 770.0, 852.0, 941.0, 1209.0, 1336.0, 1477.0, 1633.0 };
+
+        for( unsigned ii = 0; ii < COEFF_NUMBER / 2; ++ii )
+        {
+            decimated_constants_[ii]                    = get_coeff( FREQ[ii], sampling_rate / 2 );
+            decimated_constants_[ii + COEFF_NUMBER / 2] = get_coeff( FREQ[ii] * 2, sampling_rate / 2 );
+        }
+    }
 }
 
 void DtmfDetector::init_callback(
@@ -238,98 +432,323 @@ void DtmfDetector::init_callback(
     callback_   = callback;
 }
 
+int16_t DtmfDetector::get_coeff( double freq, int32_t sampling_rate )
+{
+    double coeff = 2.0 * std::cos( 2.0 * M_PI * freq / sampling_rate );
 
-void DtmfDetector::process( const int16_t * input_array, uint32_t frame_size )
+    return static_cast<int16_t>( 16383.5 * coeff );
+}
+
+void DtmfDetector::add_classifier(
+        IToneClassifier * classifier )
+{
+    if( classifier == nullptr )
+        throw std::invalid_argument( "classifier is null" );
+
+    classifier->init( sampling_rate_, SAMPLES );
+
+    Classifier c;
+
+    c.classifier    = classifier;
+
+    std::vector<double> freqs = classifier->get_frequencies();
+
+    for( auto freq : freqs )
+    {
+        if( freq <= 0 || freq * 2 >= sampling_rate_ )
+            throw std::invalid_argument( "frequency out of range" );
+
+        // reuse a bin of another classifier if possible
+
+        uint32_t bin = 0;
+        while( bin < extra_freqs_.size() && extra_freqs_[bin] != freq )
+            ++bin;
+
+        if( bin == extra_freqs_.size() )
+            extra_freqs_.push_back( freq );
+
+        c.bins.push_back( bin );
+    }
+
+    c.magnitudes.resize( IToneClassifier::DTMF_BIN_NUMBER + c.bins.size() );
+
+    classifiers_.push_back( c );
+
+    extra_coeffs_.clear();
+    extra_decimated_coeffs_.clear();
+    for( auto freq : extra_freqs_ )
+    {
+        extra_coeffs_.push_back( get_coeff( freq, sampling_rate_ ) );
+        extra_decimated_coeffs_.push_back( get_coeff( freq, sampling_rate_ / 2 ) );
+
+        // the bin must stay below the half of the decimated rate
+        if( freq * 4 >= sampling_rate_ )
+            can_decimate_ = false;
+    }
+
+    extra_T_.resize( extra_coeffs_.size() );
+}
+
+void DtmfDetector::run_classifiers( int32_t power, uint32_t count, const int16_t * coeffs, uint32_t shift )
 {
-    // Copy the input array into the middle of array_samples_.
-    // I think the first frame_count samples contain the last batch from the
-    // previous call to this function.
+    for( uint32_t ii = 0; ii < extra_coeffs_.size(); ++ii )
+    {
+        goertzel_filter_wide( coeffs[ii], internal_array_, &extra_T_[ii], count, shift );
+    }
+
+    for( auto & c : classifiers_ )
+    {
+        // the DTMF fundamentals are already in T
+        std::copy( T, T + IToneClassifier::DTMF_BIN_NUMBER, c.magnitudes.begin() );
 
-    array_samples_.insert( array_samples_.end(), & input_array[0], & input_array[frame_size] );
+        for( uint32_t ii = 0; ii < c.bins.size(); ++ii )
+            c.magnitudes[IToneClassifier::DTMF_BIN_NUMBER + ii] = extra_T_[c.bins[ii]];
 
-    // This gets used for a variety of purposes.  Most notably, it indicates
-    // the start of the circular buffer at the start of ::detect_dtmf.
+        c.classifier->on_frame( c.magnitudes.data(), power, callback_ );
+    }
+}
 
-    uint32_t frame_count = array_samples_.size();
 
-    // Read index into array_samples_ that corresponds to the current batch.
+// Sum of the absolute values of the samples.
+static uint64_t get_energy( const int16_t * samples, uint32_t size )
+{
+    uint64_t res = 0;
+
+    for( uint32_t ii = 0; ii < size; ++ii )
+        res += ( samples[ii] >= 0 ) ? samples[ii] : -samples[ii];
+
+    return res;
+}
+
+void DtmfDetector::process( const int16_t * input_array, uint32_t frame_size )
+{
+    // Running energy meter.  A frame is silent if the sum of its absolute
+    // values is below power_threshold_ * SAMPLES.  The sum of each frame is
+    // taken as its samples arrive, so a silent frame is skipped without
+    // analysis, and the sum of any other frame is not computed again by
+    // detect_dtmf.
+    uint64_t silence = static_cast<uint64_t>( power_threshold_ ) * SAMPLES;
+
+    // Read index into input_array.
     uint32_t temp_index = 0;
 
-    // If don't have enough samples to process an entire batch, then don't
-    // do anything.
-    if( frame_count >= SAMPLES )
+    // Complete the frame left over from the previous call.
+    if( buffered_ > 0 )
     {
-        // Process samples while we still have enough for an entire
-        // batch.
-        while( frame_count >= SAMPLES )
-        {
-            // Determine the tone present in the current batch
+        temp_index = std::min( SAMPLES - buffered_, frame_size );
 
-            // temp_dial_button     A tone detected in part of the input_array
-            tone_e dial_button;
-            tone_type_e type = detect_dtmf( &array_samples_[temp_index], dial_button );
+        std::copy( input_array, input_array + temp_index, frame_buffer_ + buffered_ );
 
-            // Determine if we should register it as a new tone, or
-            // ignore it as a continuation of a previously
-            // registered tone.
-            if( ( type == tone_type_e::UNDEF ) && ( prev_tone_type_ == tone_type_e::SILENCE ) )
-            {
-                // got something undefined, ignoring
-            }
-            else if( ( type == tone_type_e::TONE ) && ( prev_tone_type_ == tone_type_e::SILENCE ) )
-            {
-                // got a tone after silence, report it and update state
-                if( callback_ )
-                    callback_->on_detect( dial_button );
+        buffered_           += temp_index;
+        buffered_energy_    += get_energy( input_array, temp_index );
 
-                prev_dial_button_   = dial_button;
-                prev_tone_type_     = type;
-            }
-            else if( ( type == tone_type_e::TONE ) && ( prev_tone_type_ == tone_type_e::TONE ) )
-            {
-                // got a tone after tone, nothing to do
-                if( prev_dial_button_ != dial_button )
-                {
-                    puts( "c" );
-                    if( callback_ )
-                        callback_->on_detect( dial_button );
+        // If don't have enough samples to process an entire batch, then don't
+        // do anything.
+        if( buffered_ < SAMPLES )
+            return;
 
-                    prev_dial_button_   = dial_button;
+        if( buffered_energy_ < silence )
+            skip_silent_frame();
+        else
+            process_frame( frame_buffer_, buffered_energy_ );
 
-                }
-            }
-            else if( ( type == tone_type_e::UNDEF ) && ( prev_tone_type_ == tone_type_e::TONE ) )
-            {
-                // got something undefined after tone, ignore it
-                puts( "u" );
-            }
-            else if( ( type == tone_type_e::SILENCE ) && ( prev_tone_type_ != tone_type_e::SILENCE ) )
+        buffered_ = 0;
+    }
+
+    // Process samples while we still have enough for an entire
+    // batch.  They are analysed in place, without copying.
+    while( frame_size - temp_index >= SAMPLES )
+    {
+        const int16_t * frame = input_array + temp_index;
+
+        uint64_t energy = get_energy( frame, SAMPLES );
+
+        if( energy < silence )
+            skip_silent_frame();
+        else
+            process_frame( frame, energy );
+
+        temp_index += SAMPLES;
+    }
+
+    //
+    // We have samples left to process, but it's not enough for an
+    // entire batch.  Keep them and deal with them next time this
+    // function is called.
+    //
+    std::copy( input_array + temp_index, input_array + frame_size, frame_buffer_ );
+
+    buffered_           = frame_size - temp_index;
+    buffered_energy_    = get_energy( frame_buffer_, buffered_ );
+}
+
+uint64_t DtmfDetector::get_position() const
+{
+    return frame_position_;
+}
+
+void DtmfDetector::set_tier( tier_e tier )
+{
+    tier_ = tier;
+}
+
+DtmfDetector::tier_e DtmfDetector::get_tier() const
+{
+    if( tier_ == tier_e::DECIMATED && can_decimate_ == false )
+        return tier_e::NO_HARMONICS;
+
+    if( tier_ == tier_e::SPARSE && sparse_period_ == 1 )
+        return tier_e::FULL;
+
+    return tier_;
+}
+
+bool DtmfDetector::is_supported( tier_e tier ) const
+{
+    if( tier == tier_e::SPARSE )
+        return sparse_period_ > 1;
+
+    return tier != tier_e::DECIMATED || can_decimate_;
+}
+
+bool DtmfDetector::is_idle() const
+{
+    return silent_frames_ >= idle_after_;
+}
+
+bool DtmfDetector::is_sparse() const
+{
+    return tier_ >= tier_e::SPARSE && sparse_period_ > 1 && no_tone_frames_ >= sparse_after_;
+}
+
+void DtmfDetector::skip_silent_frame()
+{
+    for( auto & c : classifiers_ )
+        c.classifier->on_silence( callback_ );
+
+    if( prev_tone_type_ != tone_type_e::SILENCE )
+    {
+        if( callback_ )
+            callback_->on_tone_end( prev_dial_button_ );
+
+        prev_tone_type_ = tone_type_e::SILENCE;
+    }
+
+    frame_position_ += SAMPLES;
+
+    if( silent_frames_ < idle_after_ )
+        ++silent_frames_;
+
+    if( no_tone_frames_ < sparse_after_ )
+        ++no_tone_frames_;
+
+    last_power_ = 0;
+}
+
+void DtmfDetector::process_frame( const int16_t * frame, uint64_t energy )
+{
+    // A stream without DTMF candidates is analysed every sparse_period_
+    // frame only.  A tone covers sparse_period_ frames at least, so one of
+    // its frames is analysed and the stream leaves the sparse mode.
+    // The classifiers take a skipped frame as a repetition of the previous
+    // one, so a frame following a silent one is always analysed.
+    if( is_sparse() && last_power_ != 0 && ++skip_phase_ < sparse_period_ )
+    {
+        // only frames above the silence threshold get here
+        last_power_ = static_cast<int32_t>( energy / SAMPLES );
+
+        for( auto & c : classifiers_ )
+            c.classifier->on_frame( c.magnitudes.data(), last_power_, callback_ );
+
+        silent_frames_ = 0;
+
+        frame_position_ += SAMPLES;
+        return;
+    }
+
+    skip_phase_ = 0;
+
+    // Determine the tone present in the current batch
+
+    // temp_dial_button     A tone detected in part of the input_array
+    tone_e dial_button;
+    tone_type_e type = detect_dtmf( frame, energy, dial_button );
+
+    if( type == tone_type_e::SILENCE )
+    {
+        if( silent_frames_ < idle_after_ )
+            ++silent_frames_;
+    }
+    else
+    {
+        silent_frames_ = 0;
+    }
+
+    if( type == tone_type_e::TONE )
+        no_tone_frames_ = 0;
+    else if( no_tone_frames_ < sparse_after_ )
+        ++no_tone_frames_;
+
+    // Determine if we should register it as a new tone, or
+    // ignore it as a continuation of a previously
+    // registered tone.
+    if( ( type == tone_type_e::UNDEF ) && ( prev_tone_type_ == tone_type_e::SILENCE ) )
+    {
+        // got something undefined, ignoring
+    }
+    else if( ( type == tone_type_e::TONE ) && ( prev_tone_type_ == tone_type_e::SILENCE ) )
+    {
+        // got a tone after silence, report it and update state
+        if( callback_ )
+            callback_->on_detect( dial_button );
+
+        prev_dial_button_   = dial_button;
+        prev_tone_type_     = type;
+    }
+    else if( ( type == tone_type_e::TONE ) && ( prev_tone_type_ == tone_type_e::TONE ) )
+    {
+        // got a tone after tone, nothing to do
+        if( prev_dial_button_ != dial_button )
+        {
+#if DEBUG
+            puts( "c" );
+#endif
+            if( callback_ )
             {
-                // got silence after non-silence, update state
-                puts( "s" );
-                prev_tone_type_ = type;
+                callback_->on_tone_end( prev_dial_button_ );
+                callback_->on_detect( dial_button );
             }
 
-            // Store the current tone.  In light of the above
-            // behaviour, all that really matters is whether it was
-            // a tone or silence.  Finally, move on to the next
-            // batch.
-            //prev_tone_type_ = type;
+            prev_dial_button_   = dial_button;
 
-            temp_index += SAMPLES;
-            frame_count -= SAMPLES;
         }
+    }
+    else if( ( type == tone_type_e::UNDEF ) && ( prev_tone_type_ == tone_type_e::TONE ) )
+    {
+        // got something undefined after tone, ignore it
+#if DEBUG
+        puts( "u" );
+#endif
+    }
+    else if( ( type == tone_type_e::SILENCE ) && ( prev_tone_type_ != tone_type_e::SILENCE ) )
+    {
+        // got silence after non-silence, update state
+#if DEBUG
+        puts( "s" );
+#endif
+        if( callback_ )
+            callback_->on_tone_end( prev_dial_button_ );
 
-        //
-        // We have frame_count samples left to process, but it's not
-        // enough for an entire batch.  Shift these left-over
-        // samples to the beginning of our array and deal with them
-        // next time this function is called.
-        //
-        // move unprocessed elements to the beginning
-        array_samples_.erase( array_samples_.begin(), array_samples_.begin() + temp_index );
+        prev_tone_type_ = type;
     }
 
+    // Store the current tone.  In light of the above
+    // behaviour, all that really matters is whether it was
+    // a tone or silence.  Finally, move on to the next
+    // batch.
+    //prev_tone_type_ = type;
+
+    frame_position_ += SAMPLES;
 }
 //-----------------------------------------------------------------
 tone_e DtmfDetector::row_column_to_tone( int32_t row, int32_t column )
@@ -416,62 +835,119 @@ tone_e DtmfDetector::row_column_to_tone( int32_t row, int32_t column )
 }
 //-----------------------------------------------------------------
 // Detect a tone in a single batch of samples (SAMPLES elements).
-DtmfDetector::tone_type_e DtmfDetector::detect_dtmf( int16_t short_array_samples[], tone_e & tone )
+DtmfDetector::tone_type_e DtmfDetector::detect_dtmf( const int16_t short_array_samples[], uint64_t energy, tone_e & tone )
 {
     int32_t Dial = 32;
     unsigned ii;
     int32_t Sum = 0;
 
     // Dial         TODO: what is this?
-    // Sum          Sum of the absolute values of samples in the batch.
+    // Sum          Average of the absolute values of samples in the batch.
     // return_value The tone detected in this batch (can be silence).
     // ii           Iteration variable
 
-    // Quick check for silence.
-    for( ii = 0; ii < SAMPLES; ii++ )
-    {
-        if( short_array_samples[ii] >= 0 )
-            Sum += short_array_samples[ii];
-        else
-            Sum -= short_array_samples[ii];
-    }
-    Sum /= SAMPLES;
+    // Quick check for silence, the sum is taken by process().
+    Sum = static_cast<int32_t>( energy / SAMPLES );
     if( Sum < power_threshold_ )
+    {
+        for( auto & c : classifiers_ )
+            c.classifier->on_silence( callback_ );
+
+        last_power_ = 0;
+
         return tone_type_e::SILENCE;
+    }
+
+    int32_t power = Sum;
+
+    last_power_ = power;
 
-    //Normalization
-    // Iterate over each sample.
-    // First, adjusting Dial to an appropriate value for the batch.
-    for( ii = 0; ii < SAMPLES; ii++ )
+    // count        Number of samples in internal_array_.
+    // constants    Coefficients for the rate of internal_array_.
+    // shift        Shift of the Goertzel state for count and the rate.
+    uint32_t count = SAMPLES;
+    const int16_t * constants = CONSTANTS;
+    uint32_t shift = shift_;
+
+    bool is_decimated = ( tier_ >= tier_e::DECIMATED && can_decimate_ );
+
+    if( is_decimated == false )
     {
-        T[0] = static_cast<int32_t>( short_array_samples[ii] );
-        if( T[0] != 0 )
+        //Normalization
+        // Iterate over each sample.
+        // First, adjusting Dial to an appropriate value for the batch.
+        for( ii = 0; ii < SAMPLES; ii++ )
         {
-            if( Dial > norm_l( T[0] ) )
+            T[0] = static_cast<int32_t>( short_array_samples[ii] );
+            if( T[0] != 0 )
             {
-                Dial = norm_l( T[0] );
+                if( Dial > norm_l( T[0] ) )
+                {
+                    Dial = norm_l( T[0] );
+                }
             }
         }
-    }
 
-    Dial -= 16;
+        Dial -= 16;
 
-    // Next, utilize Dial for scaling and populate internal_array_.
-    for( ii = 0; ii < SAMPLES; ii++ )
+        // Next, utilize Dial for scaling and populate internal_array_.
+        for( ii = 0; ii < SAMPLES; ii++ )
+        {
+            T[0] = short_array_samples[ii];
+            internal_array_[ii] = static_cast<int16_t>( T[0] << Dial );
+        }
+    }
+    else
     {
-        T[0] = short_array_samples[ii];
-        internal_array_[ii] = static_cast<int16_t>( T[0] << Dial );
+        // Averaging of sample pairs is a crude low-pass filter, cheaper
+        // but less accurate than a proper decimation filter.
+        count       = SAMPLES / 2;
+        constants   = decimated_constants_;
+        shift       = decimated_shift_;
+
+        for( ii = 0; ii < count; ii++ )
+        {
+            internal_array_[ii] = static_cast<int16_t>( ( short_array_samples[2 * ii] + short_array_samples[2 * ii + 1] ) >> 1 );
+
+            T[0] = internal_array_[ii];
+            if( T[0] != 0 )
+            {
+                if( Dial > norm_l( T[0] ) )
+                {
+                    Dial = norm_l( T[0] );
+                }
+            }
+        }
+
+        Dial -= 16;
+
+        for( ii = 0; ii < count; ii++ )
+        {
+            T[0] = internal_array_[ii];
+            internal_array_[ii] = static_cast<int16_t>( T[0] << Dial );
+        }
     }
 
+    bool has_harmonics = ( tier_ < tier_e::NO_HARMONICS );
+
     //Frequency detection
-    goertzel_filter( CONSTANTS[0], CONSTANTS[1], internal_array_, &T[0], &T[1], SAMPLES );
-    goertzel_filter( CONSTANTS[2], CONSTANTS[3], internal_array_, &T[2], &T[3], SAMPLES );
-    goertzel_filter( CONSTANTS[4], CONSTANTS[5], internal_array_, &T[4], &T[5], SAMPLES );
-    goertzel_filter( CONSTANTS[6], CONSTANTS[7], internal_array_, &T[6], &T[7], SAMPLES );
-    goertzel_filter( CONSTANTS[8], CONSTANTS[9], internal_array_, &T[8], &T[9], SAMPLES );
-    goertzel_filter( CONSTANTS[10], CONSTANTS[11], internal_array_, &T[10], &T[11], SAMPLES );
-    goertzel_filter( CONSTANTS[12], CONSTANTS[13], internal_array_, &T[12], &T[13], SAMPLES );
-    goertzel_filter( CONSTANTS[14], CONSTANTS[15], internal_array_, &T[14], &T[15], SAMPLES );
+    // T[8] and T[9] take part in the average of the dial tones, so they
+    // are computed even without harmonics.
+    goertzel_filter( constants[0], constants[1], internal_array_, &T[0], &T[1], count, shift );
+    goertzel_filter( constants[2], constants[3], internal_array_, &T[2], &T[3], count, shift );
+    goertzel_filter( constants[4], constants[5], internal_array_, &T[4], &T[5], count, shift );
+    goertzel_filter( constants[6], constants[7], internal_array_, &T[6], &T[7], count, shift );
+    goertzel_filter( constants[8], constants[9], internal_array_, &T[8], &T[9], count, shift );
+    if( has_harmonics )
+    {
+        goertzel_filter( constants[10], constants[11], internal_array_, &T[10], &T[11], count, shift );
+        goertzel_filter( constants[12], constants[13], internal_array_, &T[12], &T[13], count, shift );
+        goertzel_filter( constants[14], constants[15], internal_array_, &T[14], &T[15], count, shift );
+    }
+
+    // the bins of the classifiers reuse the normalized frame
+    if( classifiers_.empty() == false )
+        run_classifiers( power, count, is_decimated ? extra_decimated_coeffs_.data() : extra_coeffs_.data(), shift );
 
 #if DEBUG
     for (ii = 0; ii < COEFF_NUMBER; ++ii)
@@ -553,7 +1029,7 @@ DtmfDetector::tone_type_e DtmfDetector::detect_dtmf( int16_t short_array_samples
     //If relations max row and max column to all other tones are less then
     //threshold then return
     // Check for the presence of strong harmonics.
-    for( ii = 10; ii < COEFF_NUMBER; ii++ )
+    for( ii = 10; ii < COEFF_NUMBER && has_harmonics; ii++ )
     {
         if( T[Row] / T[ii] < dial_tones_to_ohers_tones_ )
             return tone_type_e::UNDEF;
@@ -18,6 +18,7 @@ namespace dtmf
 {
 
 class IDtmfDetectorCallback;
+class IToneClassifier;
 
 // DTMF detector object
 
@@ -25,17 +26,91 @@ class DtmfDetector
 {
 public:
 
+    // Analysis tiers, each one is cheaper than the previous one and
+    // includes its savings.
+    enum class tier_e
+    {
+        FULL = 0,
+        SPARSE,         // frames are skipped after 1 s without a DTMF candidate (frames up to 13.3 ms)
+        NO_HARMONICS,   // harmonics are neither computed nor checked, more talk-off
+        DECIMATED,      // frames are decimated by 2 (16 KHz and 44.1 KHz only)
+    };
+
+    // Detection parameters.  The default values are the constants of
+    // the original implementation, dtmf_tune finds values for a corpus.
+    struct Profile
+    {
+        Profile( int32_t sampling_rate = 8000 );
+
+        int32_t     sampling_rate;
+        uint32_t    frame_size;                         // samples per frame, half to twice get_frame_size()
+        int32_t     power_threshold;                    // see power_threshold_
+        int32_t     dial_tones_to_others_tones;         // see dial_tones_to_ohers_tones_
+        int32_t     dial_tones_to_others_dial_tones;    // see dial_tones_to_ohers_dial_tones_
+    };
+
     // frame_size - input frame size
     DtmfDetector(
             int32_t sampling_rate = 8000 );
+
+    // Doesn't allocate memory.
+    // work_area - get_work_area_size( sampling_rate ) elements, owned by the caller
+    DtmfDetector(
+            int32_t sampling_rate,
+            int16_t * work_area );
+
+    // throws std::invalid_argument
+    explicit DtmfDetector(
+            const Profile & profile );
+
     ~DtmfDetector();
 
+    // Number of samples in a frame, 0 if the sampling rate is not supported
+    static uint32_t get_frame_size( int32_t sampling_rate );
+
+    // Size of the work area in int16_t, 0 if the sampling rate is not supported
+    static uint32_t get_work_area_size( int32_t sampling_rate );
+
+    // Largest frame size allowed in a profile, 0 if the sampling rate is not supported
+    static uint32_t get_max_frame_size( int32_t sampling_rate );
+
+    const Profile & get_profile() const;
+
     void init_callback( IDtmfDetectorCallback * callback );
 
+    // Registers a classifier, its bins are computed in the same pass
+    // as the DTMF bins. The classifier is not owned by the detector.
+    void add_classifier( IToneClassifier * classifier );
+
+    // Goertzel coefficient for a frequency, same as generate_coeff.py
+    static int16_t get_coeff( double freq, int32_t sampling_rate );
+
     // The DTMF detection.
     // Size of a frame is measured in int16_t(word)
     void process( const int16_t * input_frame, uint32_t frame_size );
 
+    // Position (in samples from the start of the stream) of the frame
+    // being analysed, i.e. the position of an event inside the callback.
+    uint64_t get_position() const;
+
+    void set_tier( tier_e tier );
+
+    // Tier actually applied, lower than the one set if the tier saves
+    // nothing at the sampling rate or frame size (tier_e::DECIMATED at
+    // 8 KHz, tier_e::SPARSE with frames longer than 13.3 ms).
+    tier_e get_tier() const;
+
+    // false if the tier saves nothing over the previous one at the sampling
+    // rate or frame size
+    bool is_supported( tier_e tier ) const;
+
+    // true after 2 s of silence
+    bool is_idle() const;
+
+    // true if frames are being skipped in tier_e::SPARSE, i.e. no frame
+    // has looked like a DTMF tone for 1 s
+    bool is_sparse() const;
+
 protected:
 
     enum class tone_type_e
@@ -46,11 +121,23 @@ protected:
     };
 
 
+    void init( const Profile & profile, int16_t * work_area );
+
+    // Runs detect_dtmf on a frame of SAMPLES elements and reports the result.
+    // energy - sum of the absolute values of the samples
+    void process_frame( const int16_t * frame, uint64_t energy );
+
+    // Same as process_frame for a frame known to be silent.
+    void skip_silent_frame();
+
     // This protected function determines the tone present in a single frame.
-    tone_type_e detect_dtmf( int16_t short_array_samples[], tone_e & tone );
+    // energy - sum of the absolute values of the samples
+    tone_type_e detect_dtmf( const int16_t short_array_samples[], uint64_t energy, tone_e & tone );
 
     tone_e row_column_to_tone( int32_t row, int32_t column );
 
+    void run_classifiers( int32_t power, uint32_t count, const int16_t * coeffs, uint32_t shift );
+
 protected:
     // These coefficients include the 8 DTMF frequencies plus 8 harmonics.
     static const unsigned COEFF_NUMBER = 16;
@@ -60,8 +147,18 @@ protected:
     static const int16_t CONSTANTS_16KHz[COEFF_NUMBER];
     static const int16_t CONSTANTS_44_1KHz[COEFF_NUMBER];
 
-    // This array keeps the entire buffer PLUS a single batch.
-    std::vector<int16_t> array_samples_;
+    // This array keeps the samples of an incomplete frame, which are
+    // left over from the previous call to process.  Size: SAMPLES.
+    int16_t *frame_buffer_;
+
+    // Number of samples in frame_buffer_.
+    uint32_t buffered_;
+
+    // Sum of the absolute values of the samples in frame_buffer_.
+    uint64_t buffered_energy_;
+
+    // Position of the frame being analysed.
+    uint64_t frame_position_;
 
     // The magnitude of each coefficient in the current frame.  Populated
     // by goertzel_filter
@@ -74,12 +171,16 @@ protected:
     // This is referred to as a frame.
     uint32_t SAMPLES;
 
+    // Shift of the Goertzel state for SAMPLES and for tier_e::DECIMATED.
+    uint32_t shift_;
+    uint32_t decimated_shift_;
+
     // The tone detected by the previous call to DTMF_detection.
     tone_e      prev_dial_button_;
     tone_type_e prev_tone_type_;
 
     // Used for quickly determining silence within a batch.
-    static int32_t power_threshold_;
+    int32_t power_threshold_;
     //
     // dial_tones_to_ohers_tones_ is the higher ratio.
     // dial_tones_to_ohers_dial_tones_ is the lower ratio.
@@ -88,14 +189,62 @@ protected:
     // towards strong "dial tones" than "tones".  The latter include
     // harmonics.
     //
-    static int32_t dial_tones_to_ohers_tones_;
-    static int32_t dial_tones_to_ohers_dial_tones_;
+    int32_t dial_tones_to_ohers_tones_;
+    int32_t dial_tones_to_ohers_dial_tones_;
+
+private:
+
+    struct Classifier
+    {
+        IToneClassifier         * classifier;
+        std::vector<uint32_t>   bins;           // indices into extra_T_
+        std::vector<int32_t>    magnitudes;
+    };
 
 private:
 
     IDtmfDetectorCallback   * callback_;
 
+    // Memory for frame_buffer_ and internal_array_, if allocated by the detector.
+    int16_t                 * own_work_area_;
+
     const int16_t           * CONSTANTS;
+
+    int32_t                 sampling_rate_;
+
+    Profile                 profile_;
+
+    // Bins requested by the classifiers, shared between them if the
+    // frequencies are equal.
+    std::vector<double>     extra_freqs_;
+    std::vector<int16_t>    extra_coeffs_;
+    std::vector<int32_t>    extra_T_;
+
+    std::vector<Classifier> classifiers_;
+
+    tier_e                  tier_;
+
+    // Number of silent frames in a row, the stream is idle after
+    // idle_after_ frames.
+    uint32_t                silent_frames_;
+    uint32_t                idle_after_;
+
+    // Number of frames in a row without a DTMF candidate (silence or
+    // undefined), frames are skipped in tier_e::SPARSE after sparse_after_.
+    // One frame of sparse_period_ is analysed, 1 - no frame is skipped.
+    uint32_t                no_tone_frames_;
+    uint32_t                sparse_after_;
+    uint32_t                sparse_period_;
+    uint32_t                skip_phase_;
+
+    // Power of the last frame, 0 if it was silent.  A skipped frame is
+    // passed to the classifiers with the magnitudes of the last analysed one.
+    int32_t                 last_power_;
+
+    // Coefficients for the half sampling rate, used in tier_e::DECIMATED.
+    bool                    can_decimate_;
+    int16_t                 decimated_constants_[COEFF_NUMBER];
+    std::vector<int16_t>    extra_decimated_coeffs_;
 };
 
 } // namespace dtmf
@@ -0,0 +1,230 @@
+/*
+
+Multi-stream detection engine with load-adaptive analysis tiers.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "DtmfEngine.hpp"
+
+#include <ctime>                        // clock_gettime
+#include <stdexcept>                    // std::invalid_argument
+
+namespace dtmf
+{
+
+// Length of a measurement window.
+static const uint64_t WINDOW_NS             = 500000000ULL;
+// A tier is left when the load is above the budget, and re-entered
+// when the load stays below STEP_UP_RATIO of the budget for
+// STEP_UP_WINDOWS windows.
+static const double   STEP_UP_RATIO         = 0.6;
+static const uint32_t STEP_UP_WINDOWS       = 3;
+
+static uint64_t get_time_ns( clockid_t clock )
+{
+    struct timespec ts;
+
+    clock_gettime( clock, & ts );
+
+    return static_cast<uint64_t>( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+}
+
+DtmfEngine::DtmfEngine():
+        cpu_budget_( 0 ),
+        tier_( DtmfDetector::tier_e::FULL ),
+        window_start_ns_( 0 ),
+        window_cpu_ns_( 0 ),
+        load_( 0 ),
+        low_load_windows_( 0 )
+{
+}
+
+DtmfEngine::~DtmfEngine()
+{
+}
+
+uint32_t DtmfEngine::add_stream( int32_t sampling_rate, IDtmfDetectorCallback * callback )
+{
+    return add_stream( DtmfDetector::Profile( sampling_rate ), callback );
+}
+
+uint32_t DtmfEngine::add_stream( const DtmfDetector::Profile & profile, IDtmfDetectorCallback * callback )
+{
+    std::unique_ptr<DtmfDetector> detector( new DtmfDetector( profile ) );
+
+    detector->init_callback( callback );
+    detector->set_tier( tier_ );
+
+    uint32_t id = 0;
+
+    while( id < detectors_.size() && detectors_[id] )
+        ++id;
+
+    if( id == detectors_.size() )
+        detectors_.push_back( std::move( detector ) );
+    else
+        detectors_[id] = std::move( detector );
+
+    return id;
+}
+
+void DtmfEngine::remove_stream( uint32_t id )
+{
+    if( id >= detectors_.size() || detectors_[id] == nullptr )
+        throw std::invalid_argument( "unknown stream" );
+
+    detectors_[id].reset();
+}
+
+DtmfDetector & DtmfEngine::get_detector( uint32_t id )
+{
+    if( id >= detectors_.size() || detectors_[id] == nullptr )
+        throw std::invalid_argument( "unknown stream" );
+
+    return * detectors_[id];
+}
+
+void DtmfEngine::process( uint32_t id, const int16_t * samples, uint32_t size )
+{
+    DtmfDetector & detector = get_detector( id );
+
+    if( cpu_budget_ <= 0 )
+    {
+        detector.process( samples, size );
+        return;
+    }
+
+    // thread CPU time doesn't include the time the thread was preempted
+    uint64_t start = get_time_ns( CLOCK_THREAD_CPUTIME_ID );
+
+    detector.process( samples, size );
+
+    update_load( get_time_ns( CLOCK_THREAD_CPUTIME_ID ) - start );
+}
+
+void DtmfEngine::set_cpu_budget( double budget )
+{
+    cpu_budget_         = budget;
+    window_start_ns_    = 0;
+    window_cpu_ns_      = 0;
+    low_load_windows_   = 0;
+    load_               = 0;
+
+    if( budget <= 0 )
+        set_tier( DtmfDetector::tier_e::FULL );
+}
+
+double DtmfEngine::get_load() const
+{
+    return load_;
+}
+
+DtmfDetector::tier_e DtmfEngine::get_tier() const
+{
+    return tier_;
+}
+
+DtmfDetector::tier_e DtmfEngine::get_tier( uint32_t id ) const
+{
+    if( id >= detectors_.size() || detectors_[id] == nullptr )
+        throw std::invalid_argument( "unknown stream" );
+
+    return detectors_[id]->get_tier();
+}
+
+bool DtmfEngine::is_idle( uint32_t id ) const
+{
+    if( id >= detectors_.size() || detectors_[id] == nullptr )
+        throw std::invalid_argument( "unknown stream" );
+
+    return detectors_[id]->is_idle();
+}
+
+void DtmfEngine::set_tier( DtmfDetector::tier_e tier )
+{
+    tier_ = tier;
+
+    for( auto & d : detectors_ )
+    {
+        if( d )
+            d->set_tier( tier );
+    }
+}
+
+bool DtmfEngine::is_supported( DtmfDetector::tier_e tier ) const
+{
+    for( auto & d : detectors_ )
+    {
+        if( d && d->is_supported( tier ) )
+            return true;
+    }
+
+    return false;
+}
+
+void DtmfEngine::update_load( uint64_t cpu_ns )
+{
+    window_cpu_ns_ += cpu_ns;
+
+    uint64_t now = get_time_ns( CLOCK_MONOTONIC );
+
+    if( window_start_ns_ == 0 )
+        window_start_ns_ = now;
+
+    if( now - window_start_ns_ < WINDOW_NS )
+        return;
+
+    load_ = static_cast<double>( window_cpu_ns_ ) / ( now - window_start_ns_ );
+
+    window_start_ns_    = now;
+    window_cpu_ns_      = 0;
+
+    if( load_ > cpu_budget_ )
+    {
+        low_load_windows_ = 0;
+
+        for( int tier = static_cast<int>( tier_ ) + 1; tier <= static_cast<int>( DtmfDetector::tier_e::DECIMATED ); ++tier )
+        {
+            if( is_supported( static_cast<DtmfDetector::tier_e>( tier ) ) )
+            {
+                set_tier( static_cast<DtmfDetector::tier_e>( tier ) );
+                break;
+            }
+        }
+    }
+    else if( load_ < cpu_budget_ * STEP_UP_RATIO && tier_ != DtmfDetector::tier_e::FULL )
+    {
+        if( ++low_load_windows_ >= STEP_UP_WINDOWS )
+        {
+            low_load_windows_ = 0;
+
+            int tier = static_cast<int>( tier_ ) - 1;
+
+            while( tier > static_cast<int>( DtmfDetector::tier_e::FULL ) && is_supported( static_cast<DtmfDetector::tier_e>( tier ) ) == false )
+                --tier;
+
+            set_tier( static_cast<DtmfDetector::tier_e>( tier ) );
+        }
+    }
+    else
+    {
+        low_load_windows_ = 0;
+    }
+}
+
+} // namespace dtmf
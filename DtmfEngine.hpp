@@ -0,0 +1,116 @@
+/*
+
+Multi-stream detection engine with load-adaptive analysis tiers.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_ENGINE
+#define DTMF_ENGINE
+
+#include <cstdint>      // uint32_t
+#include <memory>       // std::unique_ptr
+#include <vector>       // std::vector
+
+#include "DtmfDetector.hpp"     // DtmfDetector
+
+namespace dtmf
+{
+
+class IDtmfDetectorCallback;
+
+// Runs a DtmfDetector per stream.  If a CPU budget is set, the engine
+// measures the CPU time spent in process() and steps all streams down
+// through the tiers of DtmfDetector when the budget is exceeded, and
+// back up when the load eases.  The tier is global; a tier which saves
+// nothing for any stream (tier_e::DECIMATED with 8 KHz streams only,
+// tier_e::SPARSE with long frames) is skipped, and a stream whose rate doesn't support the global tier
+// applies the previous one, see get_tier( id ).
+//
+// Silent audio is fast-forwarded by the detectors without analysis, so a
+// stream reported by is_idle() doesn't need to be scheduled packet by
+// packet: its audio may be left to accumulate and passed in large blocks,
+// the stream stops being idle as soon as a block contains energy.
+//
+// Not thread-safe, all methods must be called from the same thread.
+
+class DtmfEngine
+{
+public:
+    DtmfEngine();
+    ~DtmfEngine();
+
+    // Returns the id of the stream, throws std::invalid_argument.
+    uint32_t add_stream( int32_t sampling_rate, IDtmfDetectorCallback * callback );
+
+    // Same as above with the detection parameters of the profile.
+    uint32_t add_stream( const DtmfDetector::Profile & profile, IDtmfDetectorCallback * callback );
+
+    void remove_stream( uint32_t id );
+
+    // Detector of the stream, e.g. for get_position() in a callback.
+    DtmfDetector & get_detector( uint32_t id );
+
+    void process( uint32_t id, const int16_t * samples, uint32_t size );
+
+    // budget - fraction of a CPU the engine may use (e.g. 0.5),
+    //          0 - no limit, streams always use tier_e::FULL
+    void set_cpu_budget( double budget );
+
+    // Measured load of the last window, fraction of a CPU.
+    double get_load() const;
+
+    // Tier set for all streams.
+    DtmfDetector::tier_e get_tier() const;
+
+    // Tier applied by the stream, see DtmfDetector::get_tier(); a stream
+    // in tier_e::SPARSE skips frames only without DTMF candidates, see
+    // DtmfDetector::is_sparse().
+    DtmfDetector::tier_e get_tier( uint32_t id ) const;
+
+    // true if the stream has been silent for 2 s, see DtmfDetector::is_idle().
+    bool is_idle( uint32_t id ) const;
+
+private:
+
+    void set_tier( DtmfDetector::tier_e tier );
+
+    // true if the tier saves CPU over the previous one for any stream.
+    bool is_supported( DtmfDetector::tier_e tier ) const;
+
+    // Called after each process(), evaluates the load once per window.
+    void update_load( uint64_t cpu_ns );
+
+private:
+
+    std::vector<std::unique_ptr<DtmfDetector>> detectors_;     // nullptr - free id
+
+    double                  cpu_budget_;
+    DtmfDetector::tier_e    tier_;
+
+    // current measurement window
+    uint64_t                window_start_ns_;
+    uint64_t                window_cpu_ns_;
+    double                  load_;
+
+    // windows in a row with a load low enough to step up
+    uint32_t                low_load_windows_;
+};
+
+} // namespace dtmf
+
+#endif // DTMF_ENGINE
@@ -0,0 +1,111 @@
+/*
+
+DTMF generator.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "DtmfGenerator.hpp"
+
+#include <cmath>                        // std::sin
+#include <stdexcept>                    // std::invalid_argument
+
+namespace dtmf
+{
+
+// Same order as tone_e.
+static const char TONE_CHARS[] = "0123456789ABCD*#";
+
+static const double ROW_FREQ[4]     = { 697.0, 770.0, 852.0, 941.0 };
+static const double COLUMN_FREQ[4]  = { 1209.0, 1336.0, 1477.0, 1633.0 };
+
+// Keypad layout, row and column for each tone_e.
+static const uint32_t TONE_ROW[16]      = { 3, 0, 0, 0, 1, 1, 1, 2, 2, 2, 0, 1, 2, 3, 3, 3 };
+static const uint32_t TONE_COLUMN[16]   = { 1, 0, 1, 2, 0, 1, 2, 0, 1, 2, 3, 3, 3, 3, 0, 2 };
+
+DtmfGenerator::DtmfGenerator(
+        int32_t     sampling_rate,
+        uint32_t    tone_duration_ms,
+        uint32_t    pause_duration_ms,
+        int16_t     amplitude ):
+        sampling_rate_( sampling_rate ),
+        tone_duration_ms_( tone_duration_ms ),
+        pause_duration_ms_( pause_duration_ms ),
+        amplitude_( amplitude )
+{
+    if( sampling_rate <= 0 )
+        throw std::invalid_argument( "invalid sampling rate" );
+}
+
+void DtmfGenerator::generate( const std::string & digits, std::vector<int16_t> & samples ) const
+{
+    for( auto c : digits )
+    {
+        tone_e tone;
+
+        if( to_tone( c, tone ) == false )
+            throw std::invalid_argument( std::string( "not a DTMF digit: " ) + c );
+
+        generate_tone( tone, tone_duration_ms_, samples );
+        generate_silence( pause_duration_ms_, samples );
+    }
+}
+
+void DtmfGenerator::generate_tone( tone_e tone, uint32_t duration_ms, std::vector<int16_t> & samples ) const
+{
+    uint32_t i = static_cast<uint32_t>( tone );
+
+    double w0 = 2.0 * M_PI * ROW_FREQ[TONE_ROW[i]] / sampling_rate_;
+    double w1 = 2.0 * M_PI * COLUMN_FREQ[TONE_COLUMN[i]] / sampling_rate_;
+
+    uint32_t n = static_cast<uint32_t>( static_cast<uint64_t>( duration_ms ) * sampling_rate_ / 1000 );
+
+    for( uint32_t ii = 0; ii < n; ++ii )
+    {
+        double v = amplitude_ * ( std::sin( w0 * ii ) + std::sin( w1 * ii ) ) / 2;
+
+        samples.push_back( static_cast<int16_t>( v ) );
+    }
+}
+
+void DtmfGenerator::generate_silence( uint32_t duration_ms, std::vector<int16_t> & samples ) const
+{
+    uint32_t n = static_cast<uint32_t>( static_cast<uint64_t>( duration_ms ) * sampling_rate_ / 1000 );
+
+    samples.insert( samples.end(), n, 0 );
+}
+
+bool DtmfGenerator::to_tone( char c, tone_e & tone )
+{
+    for( uint32_t ii = 0; ii < 16; ++ii )
+    {
+        if( TONE_CHARS[ii] == c )
+        {
+            tone = static_cast<tone_e>( ii );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+char DtmfGenerator::to_char( tone_e tone )
+{
+    return TONE_CHARS[static_cast<uint32_t>( tone )];
+}
+
+} // namespace dtmf
@@ -0,0 +1,68 @@
+/*
+
+DTMF generator.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_GENERATOR
+#define DTMF_GENERATOR
+
+#include <cstdint>      // int16_t
+#include <string>       // std::string
+#include <vector>       // std::vector
+
+#include "IDtmfDetectorCallback.hpp"    // tone_e
+
+namespace dtmf
+{
+
+// Generates PCM samples of DTMF digits.
+
+class DtmfGenerator
+{
+public:
+    DtmfGenerator(
+            int32_t     sampling_rate       = 8000,
+            uint32_t    tone_duration_ms    = 100,
+            uint32_t    pause_duration_ms   = 100,
+            int16_t     amplitude           = 8000 );
+
+    // Appends the samples of the digits, each followed by a pause.
+    // digits - "0"-"9", "A"-"D", "*", "#", throws std::invalid_argument on other characters
+    void generate( const std::string & digits, std::vector<int16_t> & samples ) const;
+
+    void generate_tone( tone_e tone, uint32_t duration_ms, std::vector<int16_t> & samples ) const;
+
+    void generate_silence( uint32_t duration_ms, std::vector<int16_t> & samples ) const;
+
+    // returns false if the character is not a DTMF digit
+    static bool to_tone( char c, tone_e & tone );
+
+    static char to_char( tone_e tone );
+
+private:
+
+    int32_t     sampling_rate_;
+    uint32_t    tone_duration_ms_;
+    uint32_t    pause_duration_ms_;
+    int16_t     amplitude_;
+};
+
+} // namespace dtmf
+
+#endif // DTMF_GENERATOR
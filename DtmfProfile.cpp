@@ -0,0 +1,134 @@
+/*
+
+Detection profile file.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "DtmfProfile.hpp"
+
+#include <cstdlib>                      // strtol
+#include <fstream>                      // std::ifstream
+#include <map>                          // std::map
+#include <stdexcept>                    // std::runtime_error
+
+namespace dtmf
+{
+
+static std::string trim( const std::string & s )
+{
+    size_t begin    = s.find_first_not_of( " \t\r" );
+    size_t end      = s.find_last_not_of( " \t\r" );
+
+    if( begin == std::string::npos )
+        return std::string();
+
+    return s.substr( begin, end - begin + 1 );
+}
+
+static int32_t get_value( const std::map<std::string, int32_t> & values, const std::string & key, int32_t def )
+{
+    auto it = values.find( key );
+
+    return ( it == values.end() ) ? def : it->second;
+}
+
+DtmfDetector::Profile load_profile( const std::string & filename, const std::string & name )
+{
+    std::ifstream is( filename.c_str() );
+
+    if( is.fail() )
+        throw std::runtime_error( "cannot open " + filename );
+
+    std::map<std::string, int32_t> values;
+
+    std::string line;
+    std::string section;
+    bool        is_found    = false;
+    uint32_t    line_num    = 0;
+
+    while( std::getline( is, line ) )
+    {
+        ++line_num;
+
+        line = trim( line );
+
+        if( line.empty() || line[0] == '#' )
+            continue;
+
+        if( line[0] == '[' )
+        {
+            if( line[line.size() - 1] != ']' )
+                throw std::runtime_error( filename + ":" + std::to_string( line_num ) + ": invalid section" );
+
+            // the wanted section is over
+            if( is_found )
+                break;
+
+            section     = trim( line.substr( 1, line.size() - 2 ) );
+            is_found    = name.empty() || section == name;
+            continue;
+        }
+
+        if( is_found == false )
+            continue;
+
+        size_t eq = line.find( '=' );
+
+        if( eq == std::string::npos )
+            throw std::runtime_error( filename + ":" + std::to_string( line_num ) + ": expected key = value" );
+
+        std::string key     = trim( line.substr( 0, eq ) );
+        std::string value   = trim( line.substr( eq + 1 ) );
+
+        if( key != "sampling_rate" && key != "frame_size" && key != "power_threshold" &&
+                key != "dial_tones_to_others_tones" && key != "dial_tones_to_others_dial_tones" )
+            throw std::runtime_error( filename + ":" + std::to_string( line_num ) + ": unknown key " + key );
+
+        char * end;
+        long   v = strtol( value.c_str(), & end, 10 );
+
+        if( value.empty() || *end != '\0' )
+            throw std::runtime_error( filename + ":" + std::to_string( line_num ) + ": invalid value " + value );
+
+        values[key] = static_cast<int32_t>( v );
+    }
+
+    if( is_found == false )
+        throw std::runtime_error( "no profile " + ( name.empty() ? std::string( "" ) : name + " " ) + "in " + filename );
+
+    DtmfDetector::Profile res( get_value( values, "sampling_rate", 8000 ) );
+
+    res.frame_size                      = get_value( values, "frame_size", res.frame_size );
+    res.power_threshold                 = get_value( values, "power_threshold", res.power_threshold );
+    res.dial_tones_to_others_tones      = get_value( values, "dial_tones_to_others_tones", res.dial_tones_to_others_tones );
+    res.dial_tones_to_others_dial_tones = get_value( values, "dial_tones_to_others_dial_tones", res.dial_tones_to_others_dial_tones );
+
+    return res;
+}
+
+void write_profile( std::ostream & os, const std::string & name, const DtmfDetector::Profile & profile )
+{
+    os << "[" << name << "]\n"
+            << "sampling_rate = " << profile.sampling_rate << "\n"
+            << "frame_size = " << profile.frame_size << "\n"
+            << "power_threshold = " << profile.power_threshold << "\n"
+            << "dial_tones_to_others_tones = " << profile.dial_tones_to_others_tones << "\n"
+            << "dial_tones_to_others_dial_tones = " << profile.dial_tones_to_others_dial_tones << "\n";
+}
+
+} // namespace dtmf
@@ -0,0 +1,53 @@
+/*
+
+Detection profile file.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_PROFILE
+#define DTMF_PROFILE
+
+#include <ostream>      // std::ostream
+#include <string>       // std::string
+
+#include "DtmfDetector.hpp"     // DtmfDetector::Profile
+
+namespace dtmf
+{
+
+// A profile file holds one or more named sections of DtmfDetector::Profile:
+//
+//   # comment
+//   [name]
+//   sampling_rate = 8000
+//   frame_size = 102
+//   power_threshold = 328
+//   dial_tones_to_others_tones = 16
+//   dial_tones_to_others_dial_tones = 6
+//
+// Missing keys keep the default values for the sampling rate.
+
+// Loads the section with the given name, the first one if name is empty.
+// throws std::runtime_error
+DtmfDetector::Profile load_profile( const std::string & filename, const std::string & name = "" );
+
+void write_profile( std::ostream & os, const std::string & name, const DtmfDetector::Profile & profile );
+
+} // namespace dtmf
+
+#endif // DTMF_PROFILE
@@ -0,0 +1,66 @@
+/*
+
+G.711 A-law and mu-law decoding.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_G711
+#define DTMF_G711
+
+#include <cstdint>      // int16_t
+
+namespace dtmf
+{
+
+inline int16_t ulaw_to_linear( uint8_t u_val )
+{
+    u_val = ~u_val;
+
+    int32_t t = ( ( u_val & 0x0F ) << 3 ) + 0x84;
+    t <<= ( u_val & 0x70 ) >> 4;
+
+    return static_cast<int16_t>( ( u_val & 0x80 ) ? ( 0x84 - t ) : ( t - 0x84 ) );
+}
+
+inline int16_t alaw_to_linear( uint8_t a_val )
+{
+    a_val ^= 0x55;
+
+    int32_t t   = ( a_val & 0x0F ) << 4;
+    int32_t seg = ( a_val & 0x70 ) >> 4;
+
+    switch( seg )
+    {
+    case 0:
+        t += 8;
+        break;
+    case 1:
+        t += 0x108;
+        break;
+    default:
+        t += 0x108;
+        t <<= seg - 1;
+        break;
+    }
+
+    return static_cast<int16_t>( ( a_val & 0x80 ) ? t : -t );
+}
+
+} // namespace dtmf
+
+#endif // DTMF_G711
@@ -47,12 +47,49 @@ enum class tone_e
     TONE_HASH,
 };
 
+// call progress and fax tones reported by CallProgressClassifier
+enum class cp_tone_e
+{
+    BUSY = 0,
+    RINGBACK,
+    SIT,
+    FAX_CNG,
+    FAX_CED,
+};
+
+// MF R1 signals reported by MfClassifier
+enum class mf_tone_e
+{
+    MF_0 = 0,
+    MF_1,
+    MF_2,
+    MF_3,
+    MF_4,
+    MF_5,
+    MF_6,
+    MF_7,
+    MF_8,
+    MF_9,
+    MF_KP,
+    MF_ST,
+    MF_ST1,
+    MF_ST2,
+    MF_ST3,
+};
+
 class IDtmfDetectorCallback
 {
 public:
     virtual ~IDtmfDetectorCallback() {};
 
     virtual void on_detect( tone_e tone ) = 0;
+
+    // the tone reported by on_detect is over (silence or another tone)
+    virtual void on_tone_end( tone_e ) {};
+
+    // reported by the classifiers registered with DtmfDetector::add_classifier
+    virtual void on_call_progress( cp_tone_e ) {};
+    virtual void on_mf_detect( mf_tone_e ) {};
 };
 
 } // namespace dtmf
@@ -0,0 +1,68 @@
+/*
+
+Tone classifier interface.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_TONE_CLASSIFIER
+#define DTMF_TONE_CLASSIFIER
+
+#include <cstdint>      // int32_t
+#include <vector>       // std::vector
+
+namespace dtmf
+{
+
+class IDtmfDetectorCallback;
+
+// A classifier is fed with Goertzel magnitudes of the DTMF frequencies
+// and of its own frequencies.  The magnitudes are computed by DtmfDetector
+// in the same pass as the DTMF bins, so adding a classifier costs only the
+// extra bins.
+
+class IToneClassifier
+{
+public:
+    // Number of the leading magnitudes passed to on_frame(), which belong
+    // to the DTMF frequencies 697, 770, 852, 941, 1209, 1336, 1477, 1633 Hz.
+    static const unsigned DTMF_BIN_NUMBER = 8;
+
+    virtual ~IToneClassifier() {};
+
+    // Called once by DtmfDetector::add_classifier.
+    // frame_size - number of samples analysed per frame
+    virtual void init( int32_t sampling_rate, uint32_t frame_size ) = 0;
+
+    // Frequencies (Hz) of the bins needed by the classifier in addition
+    // to the DTMF ones.  The magnitudes passed to on_frame() follow the
+    // same order after the DTMF bins.
+    virtual std::vector<double> get_frequencies() const = 0;
+
+    // Called for every non-silent frame.
+    // magnitudes - DTMF_BIN_NUMBER values of the DTMF frequencies, then
+    //              one value per frequency returned by get_frequencies()
+    // power      - average absolute sample value of the frame
+    virtual void on_frame( const int32_t * magnitudes, int32_t power, IDtmfDetectorCallback * callback ) = 0;
+
+    // Called for every frame below the power threshold.
+    virtual void on_silence( IDtmfDetectorCallback * callback ) = 0;
+};
+
+} // namespace dtmf
+
+#endif // DTMF_TONE_CLASSIFIER
@@ -0,0 +1,227 @@
+/*
+
+MF R1 tone classifier.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "MfClassifier.hpp"
+
+namespace dtmf
+{
+
+static const unsigned BIN_NUMBER = 6;
+
+// Frequencies of the bins requested from DtmfDetector, 700 Hz is not
+// among them as it falls into the DTMF bin of 697 Hz.
+static const double FREQUENCIES[BIN_NUMBER - 1] =
+{
+        900.0,
+        1100.0,
+        1300.0,
+        1500.0,
+        1700.0
+};
+
+// Indices of the MF bins in the magnitudes passed to on_frame().
+static const unsigned MF_BINS[BIN_NUMBER] =
+{
+        0,
+        IToneClassifier::DTMF_BIN_NUMBER,
+        IToneClassifier::DTMF_BIN_NUMBER + 1,
+        IToneClassifier::DTMF_BIN_NUMBER + 2,
+        IToneClassifier::DTMF_BIN_NUMBER + 3,
+        IToneClassifier::DTMF_BIN_NUMBER + 4
+};
+
+// DTMF bins next to each MF bin (indices into the DTMF magnitudes),
+// 0 - end of list.  They tell DTMF digits apart from MF signals
+// (e.g. '#' 941 + 1477 Hz would look like MF 8).
+static const unsigned NEIGHBOURS[BIN_NUMBER][3] =
+{
+        { 1, 0, 0 },
+        { 2, 3, 0 },
+        { 4, 0, 0 },
+        { 4, 5, 0 },
+        { 6, 0, 0 },
+        { 7, 0, 0 },
+};
+
+// Signal for a pair of frequencies (lower index first), -1 - invalid pair.
+static const int32_t PAIR_TO_TONE[BIN_NUMBER][BIN_NUMBER] =
+{
+        { -1, int32_t( mf_tone_e::MF_1 ), int32_t( mf_tone_e::MF_2 ), int32_t( mf_tone_e::MF_4 ), int32_t( mf_tone_e::MF_7 ), int32_t( mf_tone_e::MF_ST3 ) },
+        { -1, -1, int32_t( mf_tone_e::MF_3 ), int32_t( mf_tone_e::MF_5 ), int32_t( mf_tone_e::MF_8 ), int32_t( mf_tone_e::MF_ST1 ) },
+        { -1, -1, -1, int32_t( mf_tone_e::MF_6 ), int32_t( mf_tone_e::MF_9 ), int32_t( mf_tone_e::MF_KP ) },
+        { -1, -1, -1, -1, int32_t( mf_tone_e::MF_0 ), int32_t( mf_tone_e::MF_ST2 ) },
+        { -1, -1, -1, -1, -1, int32_t( mf_tone_e::MF_ST ) },
+        { -1, -1, -1, -1, -1, -1 },
+};
+
+// Same meaning as dial_tones_to_ohers_dial_tones_ of DtmfDetector.
+static const int32_t TONES_TO_OTHERS    = 6;
+// MF allows 6 dB twist, the magnitudes are proportional to the power.
+static const int32_t TWIST              = 4;
+// MF signals last at least 55 ms, the number of frames fully covered
+// by a signal is computed in init().
+static const uint32_t MIN_SIGNAL_US     = 55000;
+static const uint32_t PAUSE_FRAMES      = 2;
+
+MfClassifier::MfClassifier():
+        is_candidate_( false ),
+        candidate_( mf_tone_e::MF_0 ),
+        candidate_frames_( 0 ),
+        is_reported_( false ),
+        reported_( mf_tone_e::MF_0 ),
+        pause_frames_( 0 ),
+        required_frames_( 3 )
+{
+}
+
+void MfClassifier::init( int32_t sampling_rate, uint32_t frame_size )
+{
+    uint32_t frame_us = static_cast<uint32_t>( 1000000ULL * frame_size / sampling_rate );
+
+    // a signal not aligned to the frames covers one frame less
+    required_frames_ = MIN_SIGNAL_US / frame_us;
+
+    required_frames_ = ( required_frames_ > 1 ) ? required_frames_ - 1 : 1;
+}
+
+std::vector<double> MfClassifier::get_frequencies() const
+{
+    return std::vector<double>( FREQUENCIES, FREQUENCIES + BIN_NUMBER - 1 );
+}
+
+void MfClassifier::on_frame( const int32_t * magnitudes, int32_t, IDtmfDetectorCallback * callback )
+{
+    int32_t mf[BIN_NUMBER];
+
+    for( unsigned ii = 0; ii < BIN_NUMBER; ++ii )
+        mf[ii] = magnitudes[MF_BINS[ii]];
+
+    mf_tone_e tone;
+
+    bool is_tone = classify( mf, magnitudes, tone );
+
+    update( is_tone, tone, callback );
+}
+
+void MfClassifier::on_silence( IDtmfDetectorCallback * callback )
+{
+    update( false, mf_tone_e::MF_0, callback );
+}
+
+bool MfClassifier::classify( const int32_t * magnitudes, const int32_t * dtmf_magnitudes, mf_tone_e & tone ) const
+{
+    // find the two strongest frequencies
+    unsigned first  = 0;
+    unsigned second = 1;
+
+    if( magnitudes[second] > magnitudes[first] )
+    {
+        first   = 1;
+        second  = 0;
+    }
+
+    for( unsigned ii = 2; ii < BIN_NUMBER; ++ii )
+    {
+        if( magnitudes[ii] > magnitudes[first] )
+        {
+            second  = first;
+            first   = ii;
+        }
+        else if( magnitudes[ii] > magnitudes[second] )
+        {
+            second  = ii;
+        }
+    }
+
+    if( magnitudes[second] <= 0 )
+        return false;
+
+    if( magnitudes[second] * TWIST < magnitudes[first] )
+        return false;
+
+    for( unsigned ii = 0; ii < BIN_NUMBER; ++ii )
+    {
+        if( ii == first || ii == second )
+            continue;
+
+        int32_t other = ( magnitudes[ii] > 0 ) ? magnitudes[ii] : 1;
+
+        if( magnitudes[second] / other < TONES_TO_OTHERS )
+            return false;
+    }
+
+    // the energy must be centered on the MF frequencies, not on DTMF ones
+    for( unsigned ii = 0; ii < 3 && NEIGHBOURS[first][ii]; ++ii )
+    {
+        if( dtmf_magnitudes[NEIGHBOURS[first][ii]] > magnitudes[first] )
+            return false;
+    }
+
+    for( unsigned ii = 0; ii < 3 && NEIGHBOURS[second][ii]; ++ii )
+    {
+        if( dtmf_magnitudes[NEIGHBOURS[second][ii]] > magnitudes[second] )
+            return false;
+    }
+
+    int32_t value = ( first < second ) ? PAIR_TO_TONE[first][second] : PAIR_TO_TONE[second][first];
+
+    tone = static_cast<mf_tone_e>( value );
+
+    return true;
+}
+
+void MfClassifier::update( bool is_tone, mf_tone_e tone, IDtmfDetectorCallback * callback )
+{
+    if( is_tone == false )
+    {
+        is_candidate_       = false;
+        candidate_frames_   = 0;
+
+        if( is_reported_ && ++pause_frames_ >= PAUSE_FRAMES )
+            is_reported_    = false;
+
+        return;
+    }
+
+    pause_frames_   = 0;
+
+    if( is_candidate_ && candidate_ == tone )
+    {
+        ++candidate_frames_;
+    }
+    else
+    {
+        is_candidate_       = true;
+        candidate_          = tone;
+        candidate_frames_   = 1;
+    }
+
+    if( candidate_frames_ == required_frames_ && ( is_reported_ == false || reported_ != tone ) )
+    {
+        is_reported_    = true;
+        reported_       = tone;
+
+        if( callback )
+            callback->on_mf_detect( tone );
+    }
+}
+
+} // namespace dtmf
@@ -0,0 +1,73 @@
+/*
+
+MF R1 tone classifier.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_MF_CLASSIFIER
+#define DTMF_MF_CLASSIFIER
+
+#include "IToneClassifier.hpp"          // IToneClassifier
+#include "IDtmfDetectorCallback.hpp"    // mf_tone_e
+
+namespace dtmf
+{
+
+// Detects MF R1 signals (two out of six frequencies, 700 - 1700 Hz).
+
+class MfClassifier: public IToneClassifier
+{
+public:
+    MfClassifier();
+
+    void init( int32_t sampling_rate, uint32_t frame_size );
+
+    std::vector<double> get_frequencies() const;
+
+    void on_frame( const int32_t * magnitudes, int32_t power, IDtmfDetectorCallback * callback );
+
+    void on_silence( IDtmfDetectorCallback * callback );
+
+private:
+
+    // returns false if the frame doesn't contain a valid signal
+    // magnitudes      - the MF bins, 700 to 1700 Hz
+    // dtmf_magnitudes - the DTMF bins, see IToneClassifier::DTMF_BIN_NUMBER
+    bool classify( const int32_t * magnitudes, const int32_t * dtmf_magnitudes, mf_tone_e & tone ) const;
+
+    void update( bool is_tone, mf_tone_e tone, IDtmfDetectorCallback * callback );
+
+private:
+
+    // signal seen in the last frames, it is reported after
+    // required_frames_ consecutive frames
+    bool        is_candidate_;
+    mf_tone_e   candidate_;
+    uint32_t    candidate_frames_;
+
+    // signal reported last, cleared after a pause
+    bool        is_reported_;
+    mf_tone_e   reported_;
+    uint32_t    pause_frames_;
+
+    uint32_t    required_frames_;
+};
+
+} // namespace dtmf
+
+#endif // DTMF_MF_CLASSIFIER
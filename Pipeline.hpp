@@ -0,0 +1,282 @@
+/*
+
+Statically composed processing pipeline: decode, decimate, detect.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_PIPELINE
+#define DTMF_PIPELINE
+
+#include <cstdint>      // uint8_t
+#include <utility>      // std::forward
+
+#include "DtmfDetector.hpp"     // DtmfDetector
+#include "SampleFormat.hpp"     // Pcm16le
+
+namespace dtmf
+{
+
+// A pipeline is a chain of stages fixed at compile time, e.g.
+//
+//   Pipeline<Decode<Ulaw>, Decimate<2>, Detect> pipeline( detector );
+//
+//   pipeline.push( data, size );
+//
+// Samples are passed one by one through put(), which is inlined, so the
+// decoding and decimation of a block become a single loop, and are
+// collected into one buffer of the last stage only.  Blocks which don't
+// need to be converted (16-bit samples in host byte order) are passed as
+// they are through push() and analysed in place.
+//
+// A stage other than the last one implements:
+//
+//   template <class Next> void put( int16_t sample, Next & next );
+//   template <class Next> void push( const T * data, uint32_t size, Next & next );
+//   template <class Next> void flush( Next & next );
+//
+// The last stage implements put( sample ), push( samples, size ) and flush().
+//
+// The formats of Decode are in SampleFormat.hpp.
+
+//------------------------------------------------------------------
+// formats
+
+// true if the format is the in-memory layout of int16_t on this host
+template <class Format>
+struct IsNative
+{
+    static const bool value = false;
+};
+
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+template <>
+struct IsNative<Pcm16be>
+{
+    static const bool value = true;
+};
+#else
+template <>
+struct IsNative<Pcm16le>
+{
+    static const bool value = true;
+};
+#endif
+
+//------------------------------------------------------------------
+// stages
+
+// Decodes a byte stream.  A sample split between two calls of push()
+// is kept until its remaining bytes arrive.
+template <class Format>
+class Decode
+{
+public:
+    Decode():
+        pending_( 0 )
+    {
+    }
+
+    template <class Next>
+    void push( const uint8_t * data, uint32_t size, Next & next )
+    {
+        // complete the sample left over from the previous call
+        while( pending_ > 0 && size > 0 )
+        {
+            partial_[pending_++] = *data++;
+            --size;
+
+            if( pending_ == Format::BYTES )
+            {
+                next.put( Format::decode( partial_ ) );
+                pending_ = 0;
+            }
+        }
+
+        uint32_t count = size / Format::BYTES;
+
+        if( IsNative<Format>::value && ( reinterpret_cast<uintptr_t>( data ) % sizeof( int16_t ) ) == 0 )
+        {
+            next.push( reinterpret_cast<const int16_t *>( data ), count );
+        }
+        else
+        {
+            for( uint32_t ii = 0; ii < count; ++ii )
+                next.put( Format::decode( data + ii * Format::BYTES ) );
+        }
+
+        for( uint32_t ii = count * Format::BYTES; ii < size; ++ii )
+            partial_[pending_++] = data[ii];
+    }
+
+    template <class Next>
+    void flush( Next & next )
+    {
+        next.flush();
+    }
+
+private:
+    uint8_t     partial_[2];
+    uint32_t    pending_;
+};
+
+// Reduces the sampling rate by N, e.g. 48 KHz to 16 KHz with N = 3.
+// The average of N samples is a crude low-pass filter, the same as
+// in DtmfDetector::tier_e::DECIMATED.
+template <uint32_t N>
+class Decimate
+{
+public:
+    Decimate():
+        sum_( 0 ),
+        count_( 0 )
+    {
+    }
+
+    template <class Next>
+    void put( int16_t sample, Next & next )
+    {
+        sum_ += sample;
+
+        if( ++count_ == N )
+        {
+            next.put( static_cast<int16_t>( sum_ / static_cast<int32_t>( N ) ) );
+
+            sum_    = 0;
+            count_  = 0;
+        }
+    }
+
+    template <class Next>
+    void push( const int16_t * samples, uint32_t size, Next & next )
+    {
+        for( uint32_t ii = 0; ii < size; ++ii )
+            put( samples[ii], next );
+    }
+
+    // the samples of an incomplete group stay for the next call
+    template <class Next>
+    void flush( Next & next )
+    {
+        next.flush();
+    }
+
+private:
+    int32_t     sum_;
+    uint32_t    count_;
+};
+
+// Passes the samples to a detector, the last stage of a pipeline.
+// Blocks are analysed in place, single samples are collected into
+// a buffer of BLOCK samples.
+class Detect
+{
+public:
+    static const uint32_t BLOCK = 256;
+
+    Detect( DtmfDetector & detector ):
+        detector_( detector ),
+        size_( 0 )
+    {
+    }
+
+    void put( int16_t sample )
+    {
+        buffer_[size_++] = sample;
+
+        if( size_ == BLOCK )
+            flush();
+    }
+
+    void push( const int16_t * samples, uint32_t size )
+    {
+        flush();
+
+        detector_.process( samples, size );
+    }
+
+    void flush()
+    {
+        if( size_ > 0 )
+            detector_.process( buffer_, size_ );
+
+        size_ = 0;
+    }
+
+private:
+    DtmfDetector    & detector_;
+
+    int16_t         buffer_[BLOCK];
+    uint32_t        size_;
+};
+
+//------------------------------------------------------------------
+// composition
+
+// The arguments of the constructor are passed to the last stage, the
+// other stages are default constructed.
+template <class... Stages>
+class Pipeline;
+
+template <class Last>
+class Pipeline<Last>: public Last
+{
+public:
+    template <class... Args>
+    Pipeline( Args && ... args ):
+        Last( std::forward<Args>( args )... )
+    {
+    }
+};
+
+template <class First, class... Rest>
+class Pipeline<First, Rest...>
+{
+public:
+    template <class... Args>
+    Pipeline( Args && ... args ):
+        next_( std::forward<Args>( args )... )
+    {
+    }
+
+    void put( int16_t sample )
+    {
+        first_.put( sample, next_ );
+    }
+
+    // Processes a block, the samples which reached the last stage are
+    // analysed before the call returns.
+    template <class T>
+    void push( const T * data, uint32_t size )
+    {
+        first_.push( data, size, next_ );
+        first_.flush( next_ );
+    }
+
+    void flush()
+    {
+        first_.flush( next_ );
+    }
+
+private:
+    First                   first_;
+    Pipeline<Rest...>       next_;
+};
+
+} // namespace dtmf
+
+#endif // DTMF_PIPELINE
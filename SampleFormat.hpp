@@ -0,0 +1,97 @@
+/*
+
+Sample formats of the audio files and byte streams.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_SAMPLE_FORMAT
+#define DTMF_SAMPLE_FORMAT
+
+#include <cstdint>      // uint8_t
+
+#include "G711.hpp"     // ulaw_to_linear
+
+namespace dtmf
+{
+
+// Each format decodes a sample of BYTES bytes to 16-bit linear PCM,
+// shared by AudioFile and the Decode stage of Pipeline.
+
+struct Pcm8Unsigned
+{
+    static const uint32_t BYTES = 1;
+
+    static int16_t decode( const uint8_t * p )
+    {
+        return static_cast<int16_t>( ( p[0] - 128 ) * 256 );
+    }
+};
+
+struct Pcm8Signed
+{
+    static const uint32_t BYTES = 1;
+
+    static int16_t decode( const uint8_t * p )
+    {
+        return static_cast<int16_t>( static_cast<int8_t>( p[0] ) * 256 );
+    }
+};
+
+struct Pcm16le
+{
+    static const uint32_t BYTES = 2;
+
+    static int16_t decode( const uint8_t * p )
+    {
+        return static_cast<int16_t>( p[0] | ( p[1] << 8 ) );
+    }
+};
+
+struct Pcm16be
+{
+    static const uint32_t BYTES = 2;
+
+    static int16_t decode( const uint8_t * p )
+    {
+        return static_cast<int16_t>( ( p[0] << 8 ) | p[1] );
+    }
+};
+
+struct Ulaw
+{
+    static const uint32_t BYTES = 1;
+
+    static int16_t decode( const uint8_t * p )
+    {
+        return ulaw_to_linear( p[0] );
+    }
+};
+
+struct Alaw
+{
+    static const uint32_t BYTES = 1;
+
+    static int16_t decode( const uint8_t * p )
+    {
+        return alaw_to_linear( p[0] );
+    }
+};
+
+} // namespace dtmf
+
+#endif // DTMF_SAMPLE_FORMAT
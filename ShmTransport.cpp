@@ -0,0 +1,232 @@
+/*
+
+Shared memory transport of audio and DTMF events between processes.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ShmTransport.hpp"
+
+#include <cerrno>                       // errno
+#include <climits>                      // INT_MAX
+#include <cstring>                      // strerror
+#include <ctime>                        // timespec
+#include <stdexcept>                    // std::runtime_error
+
+#include <fcntl.h>                      // O_CREAT
+#include <linux/futex.h>                // FUTEX_WAIT
+#include <sys/mman.h>                   // mmap
+#include <sys/stat.h>                   // fstat
+#include <sys/syscall.h>                // SYS_futex
+#include <unistd.h>                     // ftruncate
+
+namespace dtmf
+{
+
+namespace shm
+{
+
+// The region is shared between processes, so the atomics must not
+// fall back to locks, and futex(2) works on 32-bit words.
+static_assert( ATOMIC_LLONG_LOCK_FREE == 2, "64-bit atomics must be lock free" );
+static_assert( ATOMIC_INT_LOCK_FREE == 2, "32-bit atomics must be lock free" );
+static_assert( sizeof( std::atomic<uint32_t> ) == sizeof( int ), "doorbell must fit futex word" );
+
+static std::string to_shm_name( const std::string & name )
+{
+    if( name.empty() || name[0] != '/' )
+        return "/" + name;
+
+    return name;
+}
+
+static std::runtime_error make_error( const std::string & what, const std::string & name )
+{
+    return std::runtime_error( what + " " + name + ": " + strerror( errno ) );
+}
+
+Mapping::Mapping( const std::string & name, bool is_creator ):
+        name_( to_shm_name( name ) ),
+        is_creator_( is_creator ),
+        region_( nullptr )
+{
+    int fd;
+
+    if( is_creator )
+    {
+        // a region left by a crashed daemon is replaced
+        shm_unlink( name_.c_str() );
+
+        fd = shm_open( name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+
+        if( fd == -1 )
+            throw make_error( "cannot create", name_ );
+
+        if( ftruncate( fd, sizeof( Region ) ) == -1 )
+        {
+            close( fd );
+            shm_unlink( name_.c_str() );
+            throw make_error( "cannot resize", name_ );
+        }
+    }
+    else
+    {
+        fd = shm_open( name_.c_str(), O_RDWR, 0 );
+
+        if( fd == -1 )
+            throw make_error( "cannot open", name_ );
+
+        struct stat st;
+
+        if( fstat( fd, & st ) == -1 || static_cast<size_t>( st.st_size ) < sizeof( Region ) )
+        {
+            close( fd );
+            throw std::runtime_error( "region is too small: " + name_ );
+        }
+    }
+
+    void * addr = mmap( nullptr, sizeof( Region ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    close( fd );
+
+    if( addr == MAP_FAILED )
+    {
+        if( is_creator )
+            shm_unlink( name_.c_str() );
+
+        throw make_error( "cannot map", name_ );
+    }
+
+    region_ = static_cast<Region*>( addr );
+
+    if( is_creator )
+    {
+        // the memory of a new region is zeroed, i.e. all slots are FREE
+        region_->version        = VERSION;
+        region_->num_streams    = MAX_STREAMS;
+        region_->magic          = MAGIC;
+    }
+    else if( region_->magic != MAGIC || region_->version != VERSION )
+    {
+        munmap( region_, sizeof( Region ) );
+        throw std::runtime_error( "incompatible region: " + name_ );
+    }
+}
+
+Mapping::~Mapping()
+{
+    munmap( region_, sizeof( Region ) );
+
+    if( is_creator_ )
+        shm_unlink( name_.c_str() );
+}
+
+Region * Mapping::get_region()
+{
+    return region_;
+}
+
+Stream * open_stream( Region * region, int32_t sampling_rate )
+{
+    for( uint32_t ii = 0; ii < region->num_streams; ++ii )
+    {
+        Stream & stream = region->streams[ii];
+
+        uint32_t expected = static_cast<uint32_t>( stream_state_e::FREE );
+
+        if( stream.state.compare_exchange_strong( expected, static_cast<uint32_t>( stream_state_e::CLAIMED ) ) == false )
+            continue;
+
+        reset( stream.audio );
+        reset( stream.events );
+
+        stream.sampling_rate    = sampling_rate;
+        stream.tier.store( 0 );
+        stream.idle_threshold.store( 0 );
+
+        stream.state.store( static_cast<uint32_t>( stream_state_e::ACTIVE ) );
+
+        return & stream;
+    }
+
+    return nullptr;
+}
+
+void close_stream( Stream * stream )
+{
+    // a stream rejected by the daemon is CLOSED already
+    uint32_t expected = static_cast<uint32_t>( stream_state_e::ACTIVE );
+
+    stream->state.compare_exchange_strong( expected, static_cast<uint32_t>( stream_state_e::CLOSING ) );
+}
+
+void free_stream( Stream * stream )
+{
+    stream->state.store( static_cast<uint32_t>( stream_state_e::FREE ) );
+}
+
+void notify_daemon( Region * region )
+{
+    // the system call is saved while the daemon is busy
+    if( region->is_daemon_sleeping.load() )
+        ring( region->doorbell );
+}
+
+void notify_daemon( Region * region, Stream * stream, const int16_t * samples, uint32_t size )
+{
+    int32_t threshold = stream->idle_threshold.load( std::memory_order_relaxed );
+
+    if( threshold > 0 && get_size( stream->audio ) < IDLE_BATCH_SIZE )
+    {
+        uint64_t energy = 0;
+
+        for( uint32_t ii = 0; ii < size; ++ii )
+            energy += ( samples[ii] >= 0 ) ? samples[ii] : -samples[ii];
+
+        if( energy < static_cast<uint64_t>( threshold ) * size )
+            return;
+    }
+
+    notify_daemon( region );
+}
+
+static long futex( std::atomic<uint32_t> & word, int op, uint32_t value, const struct timespec * timeout )
+{
+    return syscall( SYS_futex, reinterpret_cast<uint32_t*>( & word ), op, value, timeout, nullptr, 0 );
+}
+
+void wait( std::atomic<uint32_t> & doorbell, uint32_t seen, uint32_t timeout_ms )
+{
+    struct timespec timeout;
+
+    timeout.tv_sec  = timeout_ms / 1000;
+    timeout.tv_nsec = ( timeout_ms % 1000 ) * 1000000L;
+
+    // returns immediately if the doorbell has already changed
+    futex( doorbell, FUTEX_WAIT, seen, & timeout );
+}
+
+void ring( std::atomic<uint32_t> & doorbell )
+{
+    doorbell.fetch_add( 1 );
+
+    futex( doorbell, FUTEX_WAKE, INT_MAX, nullptr );
+}
+
+} // namespace shm
+
+} // namespace dtmf
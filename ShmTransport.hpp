@@ -0,0 +1,225 @@
+/*
+
+Shared memory transport of audio and DTMF events between processes.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_SHM_TRANSPORT
+#define DTMF_SHM_TRANSPORT
+
+#include <atomic>       // std::atomic
+#include <cstdint>      // uint32_t
+#include <string>       // std::string
+
+namespace dtmf
+{
+
+namespace shm
+{
+
+// The region consists of a header and MAX_STREAMS stream slots.
+// Every slot has two single-producer single-consumer rings:
+// audio from the media process to the daemon and events back.
+//
+// Producers ring the doorbell after writing audio, the daemon waits
+// on it with futex(2).  The daemon rings the event doorbell after
+// writing events.
+
+static const uint32_t MAGIC             = 0x464d5444;   // "DTMF"
+static const uint32_t VERSION           = 1;
+static const uint32_t MAX_STREAMS       = 64;
+static const uint32_t AUDIO_RING_SIZE   = 16384;        // samples, power of two
+static const uint32_t EVENT_RING_SIZE   = 64;           // events, power of two
+static const uint32_t IDLE_BATCH_SIZE   = AUDIO_RING_SIZE / 4;  // samples an idle stream may accumulate
+
+enum class stream_state_e : uint32_t
+{
+    FREE        = 0,
+    CLAIMED,        // being initialized by a producer
+    ACTIVE,
+    CLOSING,        // no more audio, the daemon closes the stream when the ring is empty
+    CLOSED,         // the daemon is done, the producer frees the slot after reading the events
+};
+
+struct Event
+{
+    uint64_t    position;       // sample position in the stream
+    uint64_t    timestamp;      // CLOCK_REALTIME of the detection, ns
+    int32_t     tone;           // tone_e
+    uint32_t    reserved;
+};
+
+// head - written by the producer, tail - written by the consumer,
+// both grow monotonically, index = value % SIZE
+template <class T, uint32_t SIZE>
+struct Ring
+{
+    std::atomic<uint64_t>   head;
+    char                    pad_0[56];
+    std::atomic<uint64_t>   tail;
+    char                    pad_1[56];
+    T                       data[SIZE];
+};
+
+typedef Ring<int16_t, AUDIO_RING_SIZE> AudioRing;
+typedef Ring<Event, EVENT_RING_SIZE>   EventRing;
+
+struct Stream
+{
+    std::atomic<uint32_t>   state;          // stream_state_e
+    int32_t                 sampling_rate;
+    std::atomic<uint32_t>   tier;           // DtmfDetector::tier_e applied by the daemon
+    std::atomic<int32_t>    idle_threshold; // power threshold while the stream is idle, 0 otherwise
+
+    AudioRing               audio;
+    EventRing               events;
+};
+
+struct Region
+{
+    uint32_t                magic;
+    uint32_t                version;
+    uint32_t                num_streams;
+    uint32_t                reserved;
+
+    std::atomic<uint32_t>   doorbell;
+    std::atomic<uint32_t>   is_daemon_sleeping;
+    std::atomic<uint32_t>   event_doorbell;
+    std::atomic<uint32_t>   is_daemon_running;
+
+    Stream                  streams[MAX_STREAMS];
+};
+
+// Maps the region, the creator initializes it and removes it in the destructor.
+class Mapping
+{
+public:
+    // throws std::runtime_error
+    Mapping( const std::string & name, bool is_creator );
+    ~Mapping();
+
+    Region * get_region();
+
+private:
+    Mapping( const Mapping & );
+    Mapping & operator=( const Mapping & );
+
+private:
+    std::string     name_;
+    bool            is_creator_;
+    Region          * region_;
+};
+
+// Writes up to size elements, returns the number of written elements.
+template <class T, uint32_t SIZE>
+uint32_t write( Ring<T, SIZE> & ring, const T * data, uint32_t size )
+{
+    uint64_t head = ring.head.load( std::memory_order_relaxed );
+    uint64_t tail = ring.tail.load( std::memory_order_acquire );
+
+    uint32_t free_size = SIZE - static_cast<uint32_t>( head - tail );
+
+    if( size > free_size )
+        size = free_size;
+
+    for( uint32_t ii = 0; ii < size; ++ii )
+        ring.data[( head + ii ) % SIZE] = data[ii];
+
+    // seq_cst pairs with is_daemon_sleeping, see notify_daemon()
+    ring.head.store( head + size );
+
+    return size;
+}
+
+// Returns the number of elements readable in place starting from *data,
+// at most up to the end of the ring buffer.
+template <class T, uint32_t SIZE>
+uint32_t peek( Ring<T, SIZE> & ring, const T ** data )
+{
+    uint64_t tail = ring.tail.load( std::memory_order_relaxed );
+    uint64_t head = ring.head.load( std::memory_order_acquire );
+
+    uint32_t index  = static_cast<uint32_t>( tail % SIZE );
+    uint32_t size   = static_cast<uint32_t>( head - tail );
+
+    if( size > SIZE - index )
+        size = SIZE - index;
+
+    *data = & ring.data[index];
+
+    return size;
+}
+
+template <class T, uint32_t SIZE>
+void consume( Ring<T, SIZE> & ring, uint32_t size )
+{
+    ring.tail.store( ring.tail.load( std::memory_order_relaxed ) + size, std::memory_order_release );
+}
+
+// seq_cst, so that it can be used to re-check the rings after setting
+// is_daemon_sleeping
+template <class T, uint32_t SIZE>
+bool is_empty( Ring<T, SIZE> & ring )
+{
+    return ring.head.load() == ring.tail.load();
+}
+
+// Number of readable elements, seq_cst as is_empty().
+template <class T, uint32_t SIZE>
+uint32_t get_size( Ring<T, SIZE> & ring )
+{
+    return static_cast<uint32_t>( ring.head.load() - ring.tail.load() );
+}
+
+// Only allowed while nobody else accesses the ring.
+template <class T, uint32_t SIZE>
+void reset( Ring<T, SIZE> & ring )
+{
+    ring.head.store( 0 );
+    ring.tail.store( 0 );
+}
+
+// Claims a free slot, returns nullptr if all slots are used.
+Stream * open_stream( Region * region, int32_t sampling_rate );
+
+// Marks the end of the audio of an active stream.
+void close_stream( Stream * stream );
+
+// Releases the slot, called by the producer once the stream is CLOSED
+// and its events are read.
+void free_stream( Stream * stream );
+
+// Wakes the daemon if it is sleeping on the doorbell.
+void notify_daemon( Region * region );
+
+// Same as above for samples just written to the stream, except that the
+// samples of an idle stream whose average absolute value is below its
+// idle_threshold don't wake the daemon until IDLE_BATCH_SIZE samples wait.
+void notify_daemon( Region * region, Stream * stream, const int16_t * samples, uint32_t size );
+
+// Waits until the value of the doorbell differs from seen or the timeout expires.
+void wait( std::atomic<uint32_t> & doorbell, uint32_t seen, uint32_t timeout_ms );
+
+// Increments the doorbell and wakes all waiters.
+void ring( std::atomic<uint32_t> & doorbell );
+
+} // namespace shm
+
+} // namespace dtmf
+
+#endif // DTMF_SHM_TRANSPORT
@@ -0,0 +1,381 @@
+/*
+
+DTMF detection daemon, reads audio from the shared memory region.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>                    // std::max
+#include <csignal>                      // signal
+#include <cstdlib>                      // atof
+#include <cstring>                      // strcmp
+#include <ctime>                        // clock_gettime
+#include <iostream>
+#include <memory>                       // std::unique_ptr
+#include <vector>
+
+#include "DtmfDetector.hpp"             // DtmfDetector
+#include "DtmfEngine.hpp"               // DtmfEngine
+#include "DtmfProfile.hpp"              // load_profile
+#include "IDtmfDetectorCallback.hpp"    // IDtmfDetectorCallback
+#include "ShmTransport.hpp"             // shm::Mapping
+
+// Time to sleep on the doorbell before checking for signals.
+#define WAIT_TIMEOUT_MS 100
+
+static volatile sig_atomic_t is_terminated = 0;
+
+static void on_signal( int )
+{
+    is_terminated = 1;
+}
+
+static uint64_t get_realtime_ns()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_REALTIME, & ts );
+
+    return static_cast<uint64_t>( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+}
+
+// Writes the detected tones into the event ring of the stream.
+class EventWriter: public dtmf::IDtmfDetectorCallback
+{
+public:
+    EventWriter():
+        stream_( nullptr ),
+        detector_( nullptr ),
+        has_events_( false ),
+        dropped_( 0 )
+    {
+    }
+
+    void init( dtmf::shm::Stream * stream, const dtmf::DtmfDetector * detector )
+    {
+        stream_     = stream;
+        detector_   = detector;
+        has_events_ = false;
+        dropped_    = 0;
+    }
+
+    virtual void on_detect( dtmf::tone_e tone )
+    {
+        dtmf::shm::Event event;
+
+        event.position  = detector_->get_position();
+        event.timestamp = get_realtime_ns();
+        event.tone      = static_cast<int32_t>( tone );
+        event.reserved  = 0;
+
+        if( dtmf::shm::write( stream_->events, & event, 1 ) == 0 )
+            ++dropped_;
+        else
+            has_events_ = true;
+    }
+
+    // returns true if events were written since the last call
+    bool take_has_events()
+    {
+        bool res    = has_events_;
+        has_events_ = false;
+        return res;
+    }
+
+    uint32_t get_dropped() const
+    {
+        return dropped_;
+    }
+
+private:
+    dtmf::shm::Stream           * stream_;
+    const dtmf::DtmfDetector    * detector_;
+    bool                        has_events_;
+    uint32_t                    dropped_;
+};
+
+struct Session
+{
+    Session():
+        is_open( false ),
+        id( 0 ),
+        checked( 0 ),
+        is_loud( false )
+    {
+    }
+
+    bool            is_open;
+    uint32_t        id;             // stream id in DtmfEngine
+    EventWriter     writer;
+
+    // audio position up to which an idle stream was checked for energy
+    uint64_t        checked;
+    bool            is_loud;
+};
+
+// true if the audio written since the last check has a frame long chunk
+// above the power threshold, i.e. an idle stream has to be scheduled
+static bool has_energy( dtmf::shm::Stream & stream, Session & session, const dtmf::DtmfDetector & detector )
+{
+    uint64_t head   = stream.audio.head.load( std::memory_order_acquire );
+    uint64_t pos    = std::max( session.checked, stream.audio.tail.load( std::memory_order_relaxed ) );
+
+    uint32_t frame_size = detector.get_profile().frame_size;
+    uint64_t threshold  = static_cast<uint64_t>( detector.get_profile().power_threshold ) * frame_size;
+
+    // an incomplete chunk is checked when the rest of it arrives
+    for( ; head - pos >= frame_size && session.is_loud == false; pos += frame_size )
+    {
+        uint64_t energy = 0;
+
+        for( uint32_t ii = 0; ii < frame_size; ++ii )
+        {
+            int16_t s = stream.audio.data[( pos + ii ) % dtmf::shm::AUDIO_RING_SIZE];
+
+            energy += ( s >= 0 ) ? s : -s;
+        }
+
+        if( energy >= threshold )
+            session.is_loud = true;
+    }
+
+    session.checked = pos;
+
+    return session.is_loud;
+}
+
+// Returns true if the stream has audio to process or has to be closed.
+static bool has_work( dtmf::shm::Stream & stream, Session & session, dtmf::DtmfEngine & engine )
+{
+    auto state = static_cast<dtmf::shm::stream_state_e>( stream.state.load() );
+
+    if( state == dtmf::shm::stream_state_e::ACTIVE || state == dtmf::shm::stream_state_e::CLOSING )
+    {
+        if( session.is_open == false || state == dtmf::shm::stream_state_e::CLOSING )
+            return true;
+
+        // an idle stream is not scheduled until a batch of audio is
+        // available or the new audio is not silent
+        if( engine.is_idle( session.id ) )
+        {
+            return dtmf::shm::get_size( stream.audio ) >= dtmf::shm::IDLE_BATCH_SIZE ||
+                    has_energy( stream, session, engine.get_detector( session.id ) );
+        }
+
+        return dtmf::shm::is_empty( stream.audio ) == false;
+    }
+
+    return false;
+}
+
+// Returns true if any audio was processed.
+static bool process_stream( uint32_t id, dtmf::shm::Stream & stream, Session & session, dtmf::DtmfEngine & engine,
+        const std::vector<dtmf::DtmfDetector::Profile> & profiles )
+{
+    auto state = static_cast<dtmf::shm::stream_state_e>( stream.state.load( std::memory_order_acquire ) );
+
+    if( state != dtmf::shm::stream_state_e::ACTIVE && state != dtmf::shm::stream_state_e::CLOSING )
+        return false;
+
+    if( has_work( stream, session, engine ) == false )
+        return false;
+
+    if( session.is_open == false )
+    {
+        if( dtmf::DtmfDetector::get_frame_size( stream.sampling_rate ) == 0 )
+        {
+            std::cerr << "stream " << id << ": unsupported sampling rate " << stream.sampling_rate << std::endl;
+
+            stream.state.store( static_cast<uint32_t>( dtmf::shm::stream_state_e::CLOSED ) );
+            return false;
+        }
+
+        // the first loaded profile for the rate, the default one otherwise
+        dtmf::DtmfDetector::Profile profile( stream.sampling_rate );
+
+        for( auto it = profiles.rbegin(); it != profiles.rend(); ++it )
+        {
+            if( it->sampling_rate == stream.sampling_rate )
+                profile = *it;
+        }
+
+        session.id      = engine.add_stream( profile, & session.writer );
+        session.is_open = true;
+        session.checked = 0;
+        session.is_loud = false;
+        session.writer.init( & stream, & engine.get_detector( session.id ) );
+
+        std::cout << "stream " << id << ": opened, " << stream.sampling_rate << " Hz" << std::endl;
+    }
+
+    bool is_busy = false;
+
+    // the samples are analysed directly in the shared memory,
+    // a wrap-around of the ring takes two iterations
+    const int16_t * samples;
+    uint32_t        size;
+
+    while( ( size = dtmf::shm::peek( stream.audio, & samples ) ) > 0 )
+    {
+        engine.process( session.id, samples, size );
+
+        dtmf::shm::consume( stream.audio, size );
+
+        is_busy = true;
+    }
+
+    stream.tier.store( static_cast<uint32_t>( engine.get_tier( session.id ) ), std::memory_order_relaxed );
+
+    // the producer wakes the daemon for an idle stream only if its audio is not silent
+    session.is_loud = false;
+
+    stream.idle_threshold.store( engine.is_idle( session.id ) ? engine.get_detector( session.id ).get_profile().power_threshold : 0,
+            std::memory_order_relaxed );
+
+    if( state == dtmf::shm::stream_state_e::CLOSING && dtmf::shm::is_empty( stream.audio ) )
+    {
+        std::cout << "stream " << id << ": closed";
+        if( session.writer.get_dropped() )
+            std::cout << ", " << session.writer.get_dropped() << " events dropped";
+        std::cout << std::endl;
+
+        engine.remove_stream( session.id );
+        session.is_open = false;
+
+        // the producer frees the slot after reading the remaining events
+        stream.state.store( static_cast<uint32_t>( dtmf::shm::stream_state_e::CLOSED ) );
+    }
+
+    return is_busy;
+}
+
+int main( int argc, char **argv )
+{
+    std::string name    = "dtmf_detector";
+    double      budget  = 0;
+
+    std::vector<dtmf::DtmfDetector::Profile> profiles;
+
+    for( int ii = 1; ii < argc; ++ii )
+    {
+        if( strcmp( argv[ii], "-n" ) == 0 && ii + 1 < argc )
+            name    = argv[++ii];
+        else if( strcmp( argv[ii], "-b" ) == 0 && ii + 1 < argc )
+            budget  = atof( argv[++ii] );
+        else if( strcmp( argv[ii], "-p" ) == 0 && ii + 1 < argc )
+        {
+            try
+            {
+                profiles.push_back( dtmf::load_profile( argv[++ii] ) );
+
+                // rejects invalid values early
+                dtmf::DtmfDetector check( profiles.back() );
+            }
+            catch( std::exception & e )
+            {
+                std::cerr << "error: " << argv[ii] << ": " << e.what() << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [-n region_name] [-b cpu_budget] [-p profile_file]..." << std::endl
+                    << "  -b    fraction of a CPU for the detection, e.g. 0.5; the analysis" << std::endl
+                    << "        is degraded when it is exceeded" << std::endl
+                    << "  -p    detection parameters written by dtmf_tune, used for the streams" << std::endl
+                    << "        of its sampling rate" << std::endl;
+            return 1;
+        }
+    }
+
+    signal( SIGINT, on_signal );
+    signal( SIGTERM, on_signal );
+
+    try
+    {
+        dtmf::shm::Mapping mapping( name, true );
+
+        dtmf::shm::Region * region = mapping.get_region();
+
+        std::unique_ptr<Session[]> sessions( new Session[region->num_streams] );
+
+        dtmf::DtmfEngine engine;
+
+        engine.set_cpu_budget( budget );
+
+        dtmf::DtmfDetector::tier_e tier = engine.get_tier();
+
+        region->is_daemon_running.store( 1 );
+
+        std::cout << "listening on " << name << ", " << region->num_streams << " streams" << std::endl;
+
+        while( is_terminated == 0 )
+        {
+            bool is_busy    = false;
+            bool has_events = false;
+
+            for( uint32_t ii = 0; ii < region->num_streams; ++ii )
+            {
+                if( process_stream( ii, region->streams[ii], sessions[ii], engine, profiles ) )
+                    is_busy = true;
+
+                if( sessions[ii].writer.take_has_events() )
+                    has_events = true;
+            }
+
+            if( has_events )
+                dtmf::shm::ring( region->event_doorbell );
+
+            if( engine.get_tier() != tier )
+            {
+                tier = engine.get_tier();
+
+                std::cout << "load " << engine.get_load() << ", tier " << static_cast<int>( tier ) << std::endl;
+            }
+
+            if( is_busy )
+                continue;
+
+            // nothing to do, sleep until a producer rings the doorbell
+            uint32_t seen = region->doorbell.load();
+
+            region->is_daemon_sleeping.store( 1 );
+
+            bool is_idle = true;
+
+            for( uint32_t ii = 0; ii < region->num_streams && is_idle; ++ii )
+            {
+                if( has_work( region->streams[ii], sessions[ii], engine ) )
+                    is_idle = false;
+            }
+
+            if( is_idle )
+                dtmf::shm::wait( region->doorbell, seen, WAIT_TIMEOUT_MS );
+
+            region->is_daemon_sleeping.store( 0 );
+        }
+
+        region->is_daemon_running.store( 0 );
+    }
+    catch( std::exception & e )
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
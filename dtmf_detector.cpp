@@ -0,0 +1,142 @@
+/*
+
+C interface of the DTMF detector.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "dtmf_detector.h"
+
+#include <new>                          // placement new
+
+#include "DtmfDetector.hpp"             // DtmfDetector
+#include "IDtmfDetectorCallback.hpp"    // IDtmfDetectorCallback
+
+namespace
+{
+
+// Writes the detected tones into the array of the caller.
+class EventWriter: public dtmf::IDtmfDetectorCallback
+{
+public:
+    EventWriter():
+        detector_( nullptr ),
+        events_( nullptr ),
+        max_events_( 0 ),
+        num_events_( 0 )
+    {
+    }
+
+    void init( const dtmf::DtmfDetector * detector )
+    {
+        detector_   = detector;
+    }
+
+    void start( dtmf_event_t * events, uint32_t max_events )
+    {
+        events_     = events;
+        max_events_ = max_events;
+        num_events_ = 0;
+    }
+
+    uint32_t get_num_events() const
+    {
+        return num_events_;
+    }
+
+    virtual void on_detect( dtmf::tone_e tone )
+    {
+        if( num_events_ >= max_events_ )
+            return;
+
+        events_[num_events_].position   = detector_->get_position();
+        events_[num_events_].tone       = static_cast<int32_t>( tone );
+
+        ++num_events_;
+    }
+
+private:
+    const dtmf::DtmfDetector    * detector_;
+
+    dtmf_event_t                * events_;
+    uint32_t                    max_events_;
+    uint32_t                    num_events_;
+};
+
+} // namespace
+
+// The work area of the detector follows the structure.
+struct dtmf_state
+{
+    dtmf_state( int32_t sampling_rate, int16_t * work_area ):
+        detector( sampling_rate, work_area )
+    {
+        writer.init( & detector );
+        detector.init_callback( & writer );
+    }
+
+    EventWriter         writer;
+    dtmf::DtmfDetector  detector;
+};
+
+static const size_t ALIGNMENT = 8;
+
+size_t dtmf_state_size( int32_t sampling_rate )
+{
+    uint32_t work_area_size = dtmf::DtmfDetector::get_work_area_size( sampling_rate );
+
+    if( work_area_size == 0 )
+        return 0;
+
+    return sizeof( dtmf_state ) + work_area_size * sizeof( int16_t );
+}
+
+uint32_t dtmf_frame_size( int32_t sampling_rate )
+{
+    return dtmf::DtmfDetector::get_frame_size( sampling_rate );
+}
+
+dtmf_state_t * dtmf_init( void * memory, size_t size, int32_t sampling_rate )
+{
+    size_t required_size = dtmf_state_size( sampling_rate );
+
+    if( memory == nullptr || required_size == 0 || size < required_size )
+        return nullptr;
+
+    if( reinterpret_cast<uintptr_t>( memory ) % ALIGNMENT )
+        return nullptr;
+
+    int16_t * work_area = reinterpret_cast<int16_t*>( static_cast<char*>( memory ) + sizeof( dtmf_state ) );
+
+    // cannot throw, the sampling rate is supported
+    return new( memory ) dtmf_state( sampling_rate, work_area );
+}
+
+uint32_t dtmf_process( dtmf_state_t * state, const int16_t * samples, uint32_t count, dtmf_event_t * events, uint32_t max_events )
+{
+    if( state == nullptr || samples == nullptr )
+        return 0;
+
+    if( events == nullptr )
+        max_events = 0;
+
+    state->writer.start( events, max_events );
+
+    state->detector.process( samples, count );
+
+    return state->writer.get_num_events();
+}
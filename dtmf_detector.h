@@ -0,0 +1,95 @@
+/*
+
+C interface of the DTMF detector.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DTMF_DETECTOR_H
+#define DTMF_DETECTOR_H
+
+#include <stddef.h>     /* size_t */
+#include <stdint.h>     /* int16_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* The library is built with hidden visibility, only these functions are exported. */
+#if defined( __GNUC__ )
+#define DTMF_EXPORT __attribute__(( visibility( "default" ) ))
+#else
+#define DTMF_EXPORT
+#endif
+
+/*
+ * None of the functions allocates memory or throws, so they can be used
+ * from real-time threads.  The state lives in a memory block provided
+ * by the caller; it can be released without any call to the library.
+ */
+
+/* same values as dtmf::tone_e */
+enum dtmf_tone
+{
+    DTMF_TONE_0 = 0,
+    DTMF_TONE_1,
+    DTMF_TONE_2,
+    DTMF_TONE_3,
+    DTMF_TONE_4,
+    DTMF_TONE_5,
+    DTMF_TONE_6,
+    DTMF_TONE_7,
+    DTMF_TONE_8,
+    DTMF_TONE_9,
+    DTMF_TONE_A,
+    DTMF_TONE_B,
+    DTMF_TONE_C,
+    DTMF_TONE_D,
+    DTMF_TONE_STAR,
+    DTMF_TONE_HASH
+};
+
+typedef struct dtmf_state dtmf_state_t;
+
+typedef struct dtmf_event
+{
+    uint64_t    position;   /* first sample of the frame with the tone, from the start of the stream */
+    int32_t     tone;       /* enum dtmf_tone */
+} dtmf_event_t;
+
+/* Size of the state in bytes, 0 if the sampling rate is not supported. */
+DTMF_EXPORT size_t dtmf_state_size( int32_t sampling_rate );
+
+/* Number of samples in a frame, 0 if the sampling rate is not supported.
+ * At most one event is reported per frame, so dtmf_process() never needs
+ * more than count / dtmf_frame_size( rate ) + 1 events. */
+DTMF_EXPORT uint32_t dtmf_frame_size( int32_t sampling_rate );
+
+/* Initializes the state in memory (aligned to 8 bytes, at least
+ * dtmf_state_size( sampling_rate ) bytes).  Returns NULL on error. */
+DTMF_EXPORT dtmf_state_t * dtmf_init( void * memory, size_t size, int32_t sampling_rate );
+
+/* Processes count samples and writes up to max_events events.
+ * Returns the number of written events, further events are dropped. */
+DTMF_EXPORT uint32_t dtmf_process( dtmf_state_t * state, const int16_t * samples, uint32_t count, dtmf_event_t * events, uint32_t max_events );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DTMF_DETECTOR_H */
@@ -0,0 +1,862 @@
+/*
+
+Builds and queries an index of DTMF digits in a tree of recordings.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>                    // std::sort, std::remove_if
+#include <atomic>                       // std::atomic
+#include <condition_variable>           // std::condition_variable
+#include <cstdlib>                      // atoi
+#include <cstring>                      // strcmp
+#include <deque>                        // std::deque
+#include <fstream>                      // std::ifstream
+#include <iostream>
+#include <map>                          // std::map
+#include <memory>                       // std::unique_ptr
+#include <mutex>                        // std::mutex
+#include <set>                          // std::set
+#include <thread>                       // std::thread
+#include <vector>
+
+#include <dirent.h>                     // opendir
+#include <sys/stat.h>                   // lstat
+
+#include "AudioFile.hpp"                // AudioFile
+#include "DtmfDetector.hpp"             // DtmfDetector
+#include "DtmfGenerator.hpp"            // DtmfGenerator::to_char
+#include "IDtmfDetectorCallback.hpp"    // IDtmfDetectorCallback
+
+// Index file layout (host byte order):
+//
+// header:      char magic[8], uint32_t num_files, uint32_t num_postings
+// keys:        uint32_t first[NUM_KEYS + 1], index of the first posting of each key
+// postings:    Posting postings[num_postings], sorted by key, file and entry
+// offsets:     uint64_t offset[num_files], position of each file record
+// file:        uint64_t size, int64_t mtime_ns, uint32_t num_entries,
+//              uint32_t path_length, char path[path_length],
+//              Entry entries[num_entries]
+//
+// Files are sorted by path, entries by offset.  The key of an entry is
+// its tone and the tone of the next entry of the file (NUM_TONES for the
+// last one), so a query reads the postings of its first two digits and
+// only the records of the files they point to.
+
+static const char MAGIC[8] = { 'D', 'T', 'M', 'F', 'I', 'D', 'X', '2' };
+
+static const uint32_t NUM_TONES     = 16;
+static const uint32_t NUM_KEYS      = NUM_TONES * ( NUM_TONES + 1 );
+
+static const uint64_t HEADER_SIZE   = 16;
+static const uint64_t POSTINGS_POS  = HEADER_SIZE + ( NUM_KEYS + 1 ) * sizeof( uint32_t );
+static const uint64_t RECORD_SIZE   = 24;           // file record without path and entries
+
+// Number of samples decoded at once.
+#define BUFLEN 4096
+
+// Default maximal pause between the digits of a sequence, ms.
+#define DEFAULT_MAX_GAP_MS 3000
+
+struct Entry
+{
+    uint32_t    offset_ms;
+    uint16_t    duration_ms;
+    uint8_t     tone;           // tone_e
+    uint8_t     reserved;
+};
+
+static_assert( sizeof( Entry ) == 8, "Entry must be packed" );
+
+struct Posting
+{
+    uint32_t    file;
+    uint32_t    entry;
+};
+
+static_assert( sizeof( Posting ) == 8, "Posting must be packed" );
+
+struct FileInfo
+{
+    std::string         path;
+    uint64_t            size;
+    int64_t             mtime_ns;
+    std::vector<Entry>  entries;
+};
+
+static void usage( const char * prog )
+{
+    std::cerr << "usage:" << std::endl
+            << "  " << prog << " build index_file directory [-j threads]" << std::endl
+            << "  " << prog << " query index_file digits [-g max_gap_ms]" << std::endl
+            << "  " << prog << " list index_file" << std::endl;
+}
+
+//------------------------------------------------------------------
+// index file
+
+static uint32_t get_key( const std::vector<Entry> & entries, size_t ii )
+{
+    uint32_t next = ( ii + 1 < entries.size() ) ? entries[ii + 1].tone : NUM_TONES;
+
+    return entries[ii].tone * ( NUM_TONES + 1 ) + next;
+}
+
+// Reads parts of an index file on demand.  Every count and offset is
+// checked against the size of the file, so a corrupt index is rejected
+// instead of allocating whatever it claims.
+class IndexReader
+{
+public:
+    IndexReader():
+        size_( 0 ),
+        num_files_( 0 ),
+        num_postings_( 0 )
+    {
+    }
+
+    // Reads the header and the keys.
+    bool open( const std::string & filename )
+    {
+        is_.open( filename.c_str(), std::ios::binary );
+
+        if( !is_ )
+            return false;
+
+        is_.seekg( 0, std::ios::end );
+        size_ = is_.tellg();
+        is_.seekg( 0 );
+
+        char magic[8];
+
+        if( read( magic, sizeof( magic ) ) == false || memcmp( magic, MAGIC, sizeof( MAGIC ) ) != 0 )
+            return false;
+
+        if( read( & num_files_, sizeof( num_files_ ) ) == false || read( & num_postings_, sizeof( num_postings_ ) ) == false )
+            return false;
+
+        uint64_t min_size = POSTINGS_POS + num_postings_ * sizeof( Posting ) + num_files_ * ( sizeof( uint64_t ) + RECORD_SIZE );
+
+        if( min_size > size_ )
+            return false;
+
+        first_.resize( NUM_KEYS + 1 );
+
+        if( read( first_.data(), first_.size() * sizeof( uint32_t ) ) == false )
+            return false;
+
+        if( first_[0] != 0 || first_[NUM_KEYS] != num_postings_ )
+            return false;
+
+        for( uint32_t ii = 0; ii < NUM_KEYS; ++ii )
+        {
+            if( first_[ii] > first_[ii + 1] )
+                return false;
+        }
+
+        return true;
+    }
+
+    uint32_t get_num_files() const
+    {
+        return num_files_;
+    }
+
+    // Appends the postings of the keys [first_key, last_key).
+    bool read_postings( uint32_t first_key, uint32_t last_key, std::vector<Posting> & postings )
+    {
+        uint32_t begin  = first_[first_key];
+        uint32_t end    = first_[last_key];
+
+        size_t size = postings.size();
+
+        postings.resize( size + end - begin );
+
+        is_.seekg( POSTINGS_POS + begin * sizeof( Posting ) );
+
+        if( read( & postings[size], ( end - begin ) * sizeof( Posting ) ) == false )
+            return false;
+
+        for( size_t ii = size; ii < postings.size(); ++ii )
+        {
+            if( postings[ii].file >= num_files_ )
+                return false;
+        }
+
+        return true;
+    }
+
+    bool read_file( uint32_t file, FileInfo & f )
+    {
+        uint64_t offset;
+
+        is_.seekg( POSTINGS_POS + num_postings_ * sizeof( Posting ) + file * sizeof( uint64_t ) );
+
+        if( read( & offset, sizeof( offset ) ) == false || offset > size_ )
+            return false;
+
+        is_.seekg( offset );
+
+        uint32_t num_entries = 0;
+        uint32_t path_length = 0;
+
+        if( read( & f.size, sizeof( f.size ) ) == false || read( & f.mtime_ns, sizeof( f.mtime_ns ) ) == false ||
+                read( & num_entries, sizeof( num_entries ) ) == false || read( & path_length, sizeof( path_length ) ) == false )
+            return false;
+
+        if( path_length + num_entries * sizeof( Entry ) > size_ - offset - RECORD_SIZE )
+            return false;
+
+        f.path.resize( path_length );
+        f.entries.resize( num_entries );
+
+        if( read( & f.path[0], path_length ) == false || read( f.entries.data(), num_entries * sizeof( Entry ) ) == false )
+            return false;
+
+        for( auto & e : f.entries )
+        {
+            if( e.tone >= NUM_TONES )
+                return false;
+        }
+
+        return true;
+    }
+
+private:
+    bool read( void * data, uint64_t size )
+    {
+        std::streamoff pos = is_.tellg();
+
+        if( pos < 0 || size > size_ - static_cast<uint64_t>( pos ) )
+            return false;
+
+        is_.read( static_cast<char*>( data ), size );
+
+        return static_cast<bool>( is_ );
+    }
+
+private:
+    std::ifstream           is_;
+    uint64_t                size_;
+    uint32_t                num_files_;
+    uint32_t                num_postings_;
+    std::vector<uint32_t>   first_;
+};
+
+static bool load_index( const std::string & filename, std::vector<FileInfo> & files )
+{
+    IndexReader reader;
+
+    if( reader.open( filename ) == false )
+        return false;
+
+    try
+    {
+        files.resize( reader.get_num_files() );
+
+        for( uint32_t ii = 0; ii < files.size(); ++ii )
+        {
+            if( reader.read_file( ii, files[ii] ) == false )
+                return false;
+        }
+    }
+    catch( std::exception & )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static bool save_index( const std::string & filename, const std::vector<FileInfo> & files )
+{
+    // postings are ordered by key with a counting sort, files and entries
+    // keep their order within a key
+    std::vector<uint32_t> first( NUM_KEYS + 1, 0 );
+
+    for( auto & f : files )
+    {
+        for( size_t ii = 0; ii < f.entries.size(); ++ii )
+            ++first[get_key( f.entries, ii ) + 1];
+    }
+
+    for( uint32_t ii = 0; ii < NUM_KEYS; ++ii )
+        first[ii + 1] += first[ii];
+
+    std::vector<Posting>    postings( first[NUM_KEYS] );
+    std::vector<uint32_t>   next( first.begin(), first.end() - 1 );
+
+    for( uint32_t ff = 0; ff < files.size(); ++ff )
+    {
+        for( size_t ii = 0; ii < files[ff].entries.size(); ++ii )
+        {
+            Posting & p = postings[next[get_key( files[ff].entries, ii )]++];
+
+            p.file  = ff;
+            p.entry = ii;
+        }
+    }
+
+    std::vector<uint64_t> offsets;
+
+    uint64_t offset = POSTINGS_POS + postings.size() * sizeof( Posting ) + files.size() * sizeof( uint64_t );
+
+    for( auto & f : files )
+    {
+        offsets.push_back( offset );
+
+        offset += RECORD_SIZE + f.path.size() + f.entries.size() * sizeof( Entry );
+    }
+
+    // written next to the old index and renamed, so a reader never sees a partial file
+    std::string tmp_name = filename + ".tmp";
+
+    {
+        std::ofstream os( tmp_name.c_str(), std::ios::binary | std::ios::trunc );
+
+        uint32_t num_files      = files.size();
+        uint32_t num_postings   = postings.size();
+
+        os.write( MAGIC, sizeof( MAGIC ) );
+        os.write( reinterpret_cast<const char*>( & num_files ), sizeof( num_files ) );
+        os.write( reinterpret_cast<const char*>( & num_postings ), sizeof( num_postings ) );
+        os.write( reinterpret_cast<const char*>( first.data() ), first.size() * sizeof( uint32_t ) );
+        os.write( reinterpret_cast<const char*>( postings.data() ), postings.size() * sizeof( Posting ) );
+        os.write( reinterpret_cast<const char*>( offsets.data() ), offsets.size() * sizeof( uint64_t ) );
+
+        for( auto & f : files )
+        {
+            uint32_t num_entries = f.entries.size();
+            uint32_t path_length = f.path.size();
+
+            os.write( reinterpret_cast<const char*>( & f.size ), sizeof( f.size ) );
+            os.write( reinterpret_cast<const char*>( & f.mtime_ns ), sizeof( f.mtime_ns ) );
+            os.write( reinterpret_cast<const char*>( & num_entries ), sizeof( num_entries ) );
+            os.write( reinterpret_cast<const char*>( & path_length ), sizeof( path_length ) );
+            os.write( f.path.data(), path_length );
+            os.write( reinterpret_cast<const char*>( f.entries.data() ), num_entries * sizeof( Entry ) );
+        }
+
+        if( !os )
+            return false;
+    }
+
+    return rename( tmp_name.c_str(), filename.c_str() ) == 0;
+}
+
+//------------------------------------------------------------------
+// scanning
+
+static void find_files( const std::string & dir, std::vector<FileInfo> & files )
+{
+    DIR * d = opendir( dir.c_str() );
+
+    if( d == nullptr )
+    {
+        std::cerr << dir << ": cannot open directory" << std::endl;
+        return;
+    }
+
+    struct dirent * e;
+
+    while( ( e = readdir( d ) ) != nullptr )
+    {
+        if( strcmp( e->d_name, "." ) == 0 || strcmp( e->d_name, ".." ) == 0 )
+            continue;
+
+        std::string path = dir + "/" + e->d_name;
+
+        struct stat st;
+
+        // symbolic links are not followed to avoid loops
+        if( lstat( path.c_str(), & st ) == -1 )
+            continue;
+
+        if( S_ISDIR( st.st_mode ) )
+        {
+            find_files( path, files );
+        }
+        else if( S_ISREG( st.st_mode ) && dtmf::AudioFile::is_supported( path ) )
+        {
+            FileInfo f;
+
+            f.path      = path;
+            f.size      = st.st_size;
+            f.mtime_ns  = static_cast<int64_t>( st.st_mtim.tv_sec ) * 1000000000LL + st.st_mtim.tv_nsec;
+
+            files.push_back( f );
+        }
+    }
+
+    closedir( d );
+}
+
+// Collects the tones of a file with their durations.
+class Collector: public dtmf::IDtmfDetectorCallback
+{
+public:
+    Collector( const dtmf::DtmfDetector & detector, int32_t sampling_rate, std::vector<Entry> & entries ):
+        detector_( detector ),
+        sampling_rate_( sampling_rate ),
+        entries_( entries ),
+        is_open_( false ),
+        start_( 0 )
+    {
+    }
+
+    virtual void on_detect( dtmf::tone_e tone )
+    {
+        Entry e;
+
+        start_          = detector_.get_position();
+
+        e.offset_ms     = static_cast<uint32_t>( start_ * 1000 / sampling_rate_ );
+        e.duration_ms   = 0;
+        e.tone          = static_cast<uint8_t>( tone );
+        e.reserved      = 0;
+
+        entries_.push_back( e );
+
+        is_open_        = true;
+    }
+
+    virtual void on_tone_end( dtmf::tone_e )
+    {
+        close( detector_.get_position() );
+    }
+
+    // end of the tone at position, if it is still open
+    void close( uint64_t position )
+    {
+        if( is_open_ == false )
+            return;
+
+        uint64_t duration = ( position - start_ ) * 1000 / sampling_rate_;
+
+        entries_.back().duration_ms = static_cast<uint16_t>( std::min<uint64_t>( duration, 0xFFFF ) );
+
+        is_open_ = false;
+    }
+
+private:
+    const dtmf::DtmfDetector    & detector_;
+    int32_t                     sampling_rate_;
+    std::vector<Entry>          & entries_;
+    bool                        is_open_;
+    uint64_t                    start_;
+};
+
+static void scan_file( const dtmf::AudioFile & audio, FileInfo & info )
+{
+    int32_t rate = audio.get_sampling_rate();
+
+    dtmf::DtmfDetector  detector( rate );
+    Collector           collector( detector, rate, info.entries );
+
+    detector.init_callback( & collector );
+
+    int16_t buf[BUFLEN];
+
+    uint32_t num_samples = audio.get_num_samples();
+
+    for( uint32_t pos = 0; pos < num_samples; pos += BUFLEN )
+    {
+        uint32_t size = audio.read( pos, buf, BUFLEN );
+
+        detector.process( buf, size );
+    }
+
+    collector.close( num_samples );
+}
+
+// Files mapped and prefetched by the reader thread, waiting for a worker.
+class Queue
+{
+public:
+    struct Item
+    {
+        FileInfo                        * info;
+        std::unique_ptr<dtmf::AudioFile> audio;     // nullptr if the file cannot be read
+    };
+
+    Queue( size_t capacity ):
+        capacity_( capacity ),
+        is_closed_( false )
+    {
+    }
+
+    void push( Item && item )
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+
+        not_full_.wait( lock, [this]{ return items_.size() < capacity_; } );
+
+        items_.push_back( std::move( item ) );
+
+        not_empty_.notify_one();
+    }
+
+    // returns false when the queue is closed and empty
+    bool pop( Item & item )
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+
+        not_empty_.wait( lock, [this]{ return items_.empty() == false || is_closed_; } );
+
+        if( items_.empty() )
+            return false;
+
+        item = std::move( items_.front() );
+
+        items_.pop_front();
+
+        not_full_.notify_one();
+
+        return true;
+    }
+
+    void close()
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+
+        is_closed_ = true;
+
+        not_empty_.notify_all();
+    }
+
+private:
+    size_t                      capacity_;
+    bool                        is_closed_;
+    std::deque<Item>            items_;
+    std::mutex                  mutex_;
+    std::condition_variable     not_full_;
+    std::condition_variable     not_empty_;
+};
+
+// Scans the files, the paths of the files that cannot be read are
+// added to failed.
+static void scan_files( const std::vector<FileInfo*> & files, uint32_t num_threads, std::set<std::string> & failed )
+{
+    // The reader maps the files and asks the kernel to read them
+    // (madvise), so a batch of reads is in flight while the workers
+    // decode the previous files.
+    Queue queue( 2 * num_threads );
+
+    std::atomic<uint32_t> num_done( 0 );
+
+    std::vector<std::thread> workers;
+
+    for( uint32_t ii = 0; ii < num_threads; ++ii )
+    {
+        workers.push_back( std::thread( [&queue, &num_done]
+        {
+            Queue::Item item;
+
+            while( queue.pop( item ) )
+            {
+                if( item.audio )
+                    scan_file( * item.audio, * item.info );
+
+                ++num_done;
+            }
+        } ) );
+    }
+
+    for( auto info : files )
+    {
+        Queue::Item item;
+
+        item.info = info;
+
+        try
+        {
+            item.audio.reset( new dtmf::AudioFile( info->path ) );
+
+            if( dtmf::DtmfDetector::get_frame_size( item.audio->get_sampling_rate() ) == 0 )
+            {
+                std::cerr << info->path << ": unsupported sampling rate " << item.audio->get_sampling_rate() << std::endl;
+                item.audio.reset();
+                failed.insert( info->path );
+            }
+            else
+            {
+                item.audio->prefetch();
+            }
+        }
+        catch( std::exception & e )
+        {
+            std::cerr << e.what() << std::endl;
+            failed.insert( info->path );
+        }
+
+        queue.push( std::move( item ) );
+    }
+
+    queue.close();
+
+    for( auto & w : workers )
+        w.join();
+}
+
+static int build( const std::string & index_name, const std::string & dir, uint32_t num_threads )
+{
+    std::vector<FileInfo> old_files;
+
+    struct stat st;
+
+    if( load_index( index_name, old_files ) == false && stat( index_name.c_str(), & st ) == 0 )
+    {
+        std::cerr << index_name << ": invalid index, rebuilding" << std::endl;
+        old_files.clear();
+    }
+
+    std::map<std::string, const FileInfo*> old_by_path;
+
+    for( auto & f : old_files )
+        old_by_path[f.path] = & f;
+
+    std::vector<FileInfo> files;
+
+    find_files( dir, files );
+
+    std::sort( files.begin(), files.end(), []( const FileInfo & a, const FileInfo & b ) { return a.path < b.path; } );
+
+    // files with unchanged size and mtime are taken from the old index
+    std::vector<FileInfo*> to_scan;
+
+    for( auto & f : files )
+    {
+        auto it = old_by_path.find( f.path );
+
+        if( it != old_by_path.end() && it->second->size == f.size && it->second->mtime_ns == f.mtime_ns )
+            f.entries = it->second->entries;
+        else
+            to_scan.push_back( & f );
+    }
+
+    std::set<std::string> failed;
+
+    scan_files( to_scan, num_threads, failed );
+
+    uint32_t num_unchanged = files.size() - to_scan.size();
+
+    // the failed files are left out of the index to be retried by the next build
+    files.erase( std::remove_if( files.begin(), files.end(), [&failed]( const FileInfo & f ) { return failed.count( f.path ) > 0; } ), files.end() );
+
+    if( save_index( index_name, files ) == false )
+    {
+        std::cerr << index_name << ": cannot write index" << std::endl;
+        return 1;
+    }
+
+    std::cout << files.size() << " files, " << to_scan.size() - failed.size() << " scanned, "
+            << num_unchanged << " unchanged, " << failed.size() << " failed" << std::endl;
+
+    return 0;
+}
+
+//------------------------------------------------------------------
+// queries
+
+static std::string to_string( const Entry & e )
+{
+    std::string res( 1, dtmf::DtmfGenerator::to_char( static_cast<dtmf::tone_e>( e.tone ) ) );
+
+    return res + " " + std::to_string( e.offset_ms ) + " " + std::to_string( e.duration_ms );
+}
+
+// true if the entries starting with ii are the tones with pauses up to max_gap_ms
+static bool is_match( const std::vector<Entry> & e, size_t ii, const std::vector<uint8_t> & tones, uint32_t max_gap_ms )
+{
+    if( ii + tones.size() > e.size() )
+        return false;
+
+    for( size_t k = 0; k < tones.size(); ++k )
+    {
+        if( e[ii + k].tone != tones[k] )
+            return false;
+
+        if( k > 0 && e[ii + k].offset_ms > e[ii + k - 1].offset_ms + e[ii + k - 1].duration_ms + max_gap_ms )
+            return false;
+    }
+
+    return true;
+}
+
+static int query( const std::string & index_name, const std::string & digits, uint32_t max_gap_ms )
+{
+    IndexReader reader;
+
+    if( reader.open( index_name ) == false )
+    {
+        std::cerr << index_name << ": cannot read index" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint8_t> tones;
+
+    for( auto c : digits )
+    {
+        dtmf::tone_e tone;
+
+        if( dtmf::DtmfGenerator::to_tone( c, tone ) == false )
+        {
+            std::cerr << "not a DTMF digit: " << c << std::endl;
+            return 1;
+        }
+
+        tones.push_back( static_cast<uint8_t>( tone ) );
+    }
+
+    if( tones.empty() )
+    {
+        std::cerr << "no digits to find" << std::endl;
+        return 1;
+    }
+
+    // a single digit is followed by any tone or by the end of the file
+    uint32_t first_key  = tones[0] * ( NUM_TONES + 1 );
+    uint32_t last_key   = first_key + NUM_TONES + 1;
+
+    if( tones.size() > 1 )
+    {
+        first_key   += tones[1];
+        last_key    = first_key + 1;
+    }
+
+    std::vector<Posting> postings;
+
+    if( reader.read_postings( first_key, last_key, postings ) == false )
+    {
+        std::cerr << index_name << ": cannot read index" << std::endl;
+        return 1;
+    }
+
+    std::sort( postings.begin(), postings.end(), []( const Posting & a, const Posting & b )
+            { return a.file < b.file || ( a.file == b.file && a.entry < b.entry ); } );
+
+    uint32_t num_found = 0;
+
+    FileInfo f;
+    bool     is_loaded = false;
+
+    for( size_t ii = 0; ii < postings.size(); ++ii )
+    {
+        // only the records of the files with a posting are read
+        if( is_loaded == false || postings[ii].file != postings[ii - 1].file )
+        {
+            if( reader.read_file( postings[ii].file, f ) == false )
+            {
+                std::cerr << index_name << ": cannot read index" << std::endl;
+                return 1;
+            }
+
+            is_loaded = true;
+        }
+
+        if( postings[ii].entry >= f.entries.size() )
+        {
+            std::cerr << index_name << ": cannot read index" << std::endl;
+            return 1;
+        }
+
+        if( is_match( f.entries, postings[ii].entry, tones, max_gap_ms ) )
+        {
+            std::cout << f.path << " " << f.entries[postings[ii].entry].offset_ms << " ms" << std::endl;
+            ++num_found;
+        }
+    }
+
+    return num_found ? 0 : 2;
+}
+
+static int list( const std::string & index_name )
+{
+    std::vector<FileInfo> files;
+
+    if( load_index( index_name, files ) == false )
+    {
+        std::cerr << index_name << ": cannot read index" << std::endl;
+        return 1;
+    }
+
+    for( auto & f : files )
+    {
+        std::cout << f.path << std::endl;
+
+        for( auto & e : f.entries )
+            std::cout << "    " << to_string( e ) << std::endl;
+    }
+
+    return 0;
+}
+
+int main( int argc, char **argv )
+{
+    if( argc < 3 )
+    {
+        usage( argv[0] );
+        return 1;
+    }
+
+    std::string command     = argv[1];
+    std::string index_name  = argv[2];
+
+    try
+    {
+        if( command == "build" && argc >= 4 )
+        {
+            uint32_t num_threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+            if( argc == 6 && strcmp( argv[4], "-j" ) == 0 && atoi( argv[5] ) > 0 )
+                num_threads = atoi( argv[5] );
+            else if( argc != 4 )
+            {
+                usage( argv[0] );
+                return 1;
+            }
+
+            return build( index_name, argv[3], num_threads );
+        }
+        else if( command == "query" && argc >= 4 )
+        {
+            uint32_t max_gap_ms = DEFAULT_MAX_GAP_MS;
+
+            if( argc == 6 && strcmp( argv[4], "-g" ) == 0 )
+                max_gap_ms = atoi( argv[5] );
+            else if( argc != 4 )
+            {
+                usage( argv[0] );
+                return 1;
+            }
+
+            return query( index_name, argv[3], max_gap_ms );
+        }
+        else if( command == "list" && argc == 3 )
+        {
+            return list( index_name );
+        }
+    }
+    catch( std::exception & e )
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    usage( argv[0] );
+    return 1;
+}
@@ -0,0 +1,602 @@
+/*
+
+Sweeps the detection parameters over a labelled corpus and writes the
+Pareto front of accuracy vs. CPU as a profile file.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>                    // std::sort, std::find_if
+#include <chrono>                       // std::chrono::steady_clock
+#include <cmath>                        // std::sin
+#include <cstdlib>                      // atoi
+#include <cstring>                      // strcmp
+#include <fstream>                      // std::ofstream
+#include <iomanip>                      // std::setw
+#include <iostream>
+#include <random>                       // std::mt19937
+#include <sstream>                      // std::ostringstream
+#include <vector>
+
+#include <dirent.h>                     // opendir
+
+#include "AudioFile.hpp"                // AudioFile
+#include "DtmfDetector.hpp"             // DtmfDetector
+#include "DtmfGenerator.hpp"            // DtmfGenerator
+#include "DtmfProfile.hpp"              // write_profile
+#include "IDtmfDetectorCallback.hpp"    // IDtmfDetectorCallback
+
+// Swept values.  Frame sizes are given for 8 KHz and scaled to the rate.
+static const int32_t  POWER_THRESHOLDS[]    = { 164, 246, 328, 492, 656 };
+static const int32_t  TONES_RATIOS[]        = { 8, 12, 16, 24, 32 };
+static const int32_t  DIAL_TONES_RATIOS[]   = { 3, 4, 6, 8, 10 };
+static const uint32_t FRAME_SIZES_8KHZ[]    = { 64, 80, 102, 128, 160, 204 };
+
+// Size of a packet passed to the detector, ms.
+#define PACKET_MS       20
+
+// Default number of timing runs per setting.
+#define DEFAULT_REPEATS 3
+
+// Relative CPU difference below which two settings are equally fast,
+// the timing of a run varies by a few percent.
+static const double CPU_TOLERANCE   = 0.05;
+
+#define ARRAY_SIZE( a ) ( sizeof( a ) / sizeof( a[0] ) )
+
+static void usage( const char * prog )
+{
+    std::cerr << "usage: " << prog << " [-r sampling_rate] [-d test_data_dir] [-n repeats] [-o profile_file]" << std::endl
+            << "  -d    directory with labelled recordings, default test-data" << std::endl
+            << "  -n    number of timing runs per setting, the fastest one is taken, default " << DEFAULT_REPEATS << std::endl
+            << "  -o    file for the profiles of the Pareto front" << std::endl;
+}
+
+struct Clip
+{
+    std::string             name;
+    std::string             digits;     // expected digits, empty for talk-off audio
+    std::vector<int16_t>    samples;
+};
+
+struct Result
+{
+    dtmf::DtmfDetector::Profile profile;
+
+    uint32_t    detected;               // expected digits which were detected
+    uint32_t    expected;
+    uint32_t    false_positives;        // detected digits which were not expected
+    double      ns_per_frame;
+    double      us_per_second;          // CPU per second of audio
+};
+
+class Collector: public dtmf::IDtmfDetectorCallback
+{
+public:
+    virtual void on_detect( dtmf::tone_e tone )
+    {
+        digits += dtmf::DtmfGenerator::to_char( tone );
+    }
+
+    std::string digits;
+};
+
+//------------------------------------------------------------------
+// corpus
+
+// Labels test-data/DtmfX.au style names: X is the digit, "Star" is *, "-" is #.
+static bool get_label( const std::string & filename, std::string & digits )
+{
+    size_t dot = filename.rfind( '.' );
+
+    if( filename.compare( 0, 4, "Dtmf" ) != 0 || dot == std::string::npos )
+        return false;
+
+    std::string label = filename.substr( 4, dot - 4 );
+
+    if( label == "Star" )
+        label = "*";
+    else if( label == "-" )
+        label = "#";
+
+    dtmf::tone_e tone;
+
+    if( label.size() != 1 || dtmf::DtmfGenerator::to_tone( label[0], tone ) == false )
+        return false;
+
+    digits = label;
+
+    return true;
+}
+
+static void load_recordings( const std::string & dir, int32_t sampling_rate, std::vector<Clip> & clips )
+{
+    DIR * d = opendir( dir.c_str() );
+
+    if( d == nullptr )
+    {
+        std::cerr << "warning: cannot open " << dir << ", using generated audio only" << std::endl;
+        return;
+    }
+
+    std::vector<std::string> names;
+
+    while( struct dirent * e = readdir( d ) )
+        names.push_back( e->d_name );
+
+    closedir( d );
+
+    std::sort( names.begin(), names.end() );
+
+    for( auto & name : names )
+    {
+        Clip clip;
+
+        if( dtmf::AudioFile::is_supported( name ) == false || get_label( name, clip.digits ) == false )
+            continue;
+
+        dtmf::AudioFile file( dir + "/" + name );
+
+        if( file.get_sampling_rate() != sampling_rate )
+            continue;
+
+        clip.name = name;
+        clip.samples.resize( file.get_num_samples() );
+
+        file.read( 0, clip.samples.data(), file.get_num_samples() );
+
+        clips.push_back( clip );
+    }
+}
+
+static void add_noise( std::mt19937 & rng, double rms, std::vector<int16_t> & samples, size_t pos = 0 )
+{
+    std::normal_distribution<double> noise( 0, rms );
+
+    for( size_t ii = pos; ii < samples.size(); ++ii )
+    {
+        double v = samples[ii] + noise( rng );
+
+        samples[ii] = static_cast<int16_t>( std::max( -32768.0, std::min( 32767.0, v ) ) );
+    }
+}
+
+// Random digits of various durations, levels and signal to noise ratios.
+static void generate_noisy( std::mt19937 & rng, int32_t sampling_rate, std::vector<Clip> & clips )
+{
+    static const uint32_t   TONE_MS[]   = { 45, 70, 100 };
+    static const int16_t    AMPLITUDE[] = { 1000, 6000 };
+    static const double     SNR_DB[]    = { 30, 15, 10, 6 };
+
+    static const char       DIGITS[]    = "0123456789ABCD*#";
+
+    std::uniform_int_distribution<int> digit( 0, 15 );
+
+    for( auto tone_ms : TONE_MS )
+    {
+        for( auto amplitude : AMPLITUDE )
+        {
+            for( auto snr : SNR_DB )
+            {
+                Clip clip;
+
+                for( int ii = 0; ii < 16; ++ii )
+                    clip.digits += DIGITS[digit( rng )];
+
+                dtmf::DtmfGenerator generator( sampling_rate, tone_ms, tone_ms, amplitude );
+
+                generator.generate_silence( 300, clip.samples );
+                generator.generate( clip.digits, clip.samples );
+
+                // each component has the amplitude of amplitude / 2
+                double signal_rms = amplitude / 2.0;
+
+                add_noise( rng, signal_rms / std::pow( 10.0, snr / 20 ), clip.samples );
+
+                std::ostringstream os;
+                os << "dtmf " << tone_ms << " ms, amplitude " << amplitude << ", snr " << snr << " dB";
+                clip.name = os.str();
+
+                clips.push_back( clip );
+            }
+        }
+    }
+}
+
+// Appends a tone of harmonics of f0, which glides to f1.  gains[k] is the
+// amplitude of the harmonic k + 1.
+static void add_harmonics( int32_t sampling_rate, double f0, double f1, uint32_t duration_ms,
+        const std::vector<double> & gains, std::vector<int16_t> & samples )
+{
+    uint32_t n = static_cast<uint32_t>( static_cast<uint64_t>( duration_ms ) * sampling_rate / 1000 );
+
+    std::vector<double> phases( gains.size() );
+
+    for( uint32_t ii = 0; ii < n; ++ii )
+    {
+        double f        = f0 + ( f1 - f0 ) * ii / n;
+        // Hann envelope
+        double envelope = 0.5 - 0.5 * std::cos( 2 * M_PI * ii / n );
+        double v        = 0;
+
+        for( size_t k = 0; k < gains.size(); ++k )
+        {
+            phases[k] += 2 * M_PI * f * ( k + 1 ) / sampling_rate;
+
+            if( f * ( k + 1 ) * 2 < sampling_rate )
+                v += gains[k] * std::sin( phases[k] );
+        }
+
+        samples.push_back( static_cast<int16_t>( std::max( -32768.0, std::min( 32767.0, v * envelope ) ) ) );
+    }
+}
+
+// Talk-off audio: voiced syllables with gliding pitch and two formants,
+// and chords of musical notes with overtones.  Nothing should be detected.
+static void generate_talk_off( std::mt19937 & rng, int32_t sampling_rate, std::vector<Clip> & clips )
+{
+    std::uniform_real_distribution<double> uniform( 0, 1 );
+
+    dtmf::DtmfGenerator generator( sampling_rate );
+
+    for( int jj = 0; jj < 6; ++jj )
+    {
+        Clip clip;
+
+        clip.name = "speech " + std::to_string( jj );
+
+        while( clip.samples.size() < static_cast<size_t>( sampling_rate ) * 5 )
+        {
+            double f0       = 90 + 210 * uniform( rng );
+            double f1       = f0 * ( 0.7 + 0.6 * uniform( rng ) );
+            double formant1 = 300 + 600 * uniform( rng );
+            double formant2 = 900 + 1600 * uniform( rng );
+            double level    = 2000 + 6000 * uniform( rng );
+
+            std::vector<double> gains;
+
+            for( uint32_t k = 1; f0 * k < 4000; ++k )
+            {
+                double f = f0 * k;
+                double g = 1 + 4 * std::exp( -std::pow( ( f - formant1 ) / 150, 2 ) ) + 3 * std::exp( -std::pow( ( f - formant2 ) / 200, 2 ) );
+
+                gains.push_back( level * g / ( k * 3 ) );
+            }
+
+            add_harmonics( sampling_rate, f0, f1, 80 + static_cast<uint32_t>( 220 * uniform( rng ) ), gains, clip.samples );
+
+            generator.generate_silence( 30 + static_cast<uint32_t>( 170 * uniform( rng ) ), clip.samples );
+        }
+
+        add_noise( rng, 30, clip.samples );
+
+        clips.push_back( clip );
+    }
+
+    for( int jj = 0; jj < 3; ++jj )
+    {
+        Clip clip;
+
+        clip.name = "music " + std::to_string( jj );
+
+        while( clip.samples.size() < static_cast<size_t>( sampling_rate ) * 5 )
+        {
+            uint32_t duration_ms    = 100 + static_cast<uint32_t>( 300 * uniform( rng ) );
+            size_t   start          = clip.samples.size();
+
+            // notes between C5 and C7 with 4 overtones, mixed together
+            for( int note = 0; note < 2; ++note )
+            {
+                double f = 523.25 * std::pow( 2.0, static_cast<int>( 24 * uniform( rng ) ) / 12.0 );
+
+                std::vector<double> gains;
+
+                for( uint32_t k = 1; k <= 4; ++k )
+                    gains.push_back( 3000.0 / k );
+
+                std::vector<int16_t> tone;
+
+                add_harmonics( sampling_rate, f, f, duration_ms, gains, tone );
+
+                if( clip.samples.size() < start + tone.size() )
+                    clip.samples.resize( start + tone.size(), 0 );
+
+                for( size_t ii = 0; ii < tone.size(); ++ii )
+                    clip.samples[start + ii] = static_cast<int16_t>( ( clip.samples[start + ii] + tone[ii] ) / 2 );
+            }
+        }
+
+        add_noise( rng, 30, clip.samples );
+
+        clips.push_back( clip );
+    }
+}
+
+//------------------------------------------------------------------
+// evaluation
+
+// Length of the longest common subsequence, i.e. the number of digits
+// detected in the right order.
+static uint32_t get_matches( const std::string & expected, const std::string & detected )
+{
+    std::vector<uint32_t> prev( detected.size() + 1 ), cur( detected.size() + 1 );
+
+    for( size_t ii = 0; ii < expected.size(); ++ii )
+    {
+        for( size_t jj = 0; jj < detected.size(); ++jj )
+            cur[jj + 1] = ( expected[ii] == detected[jj] ) ? prev[jj] + 1 : std::max( prev[jj + 1], cur[jj] );
+
+        std::swap( prev, cur );
+    }
+
+    return prev[detected.size()];
+}
+
+static Result evaluate( const dtmf::DtmfDetector::Profile & profile, const std::vector<Clip> & clips, uint32_t repeats )
+{
+    Result res;
+
+    res.profile         = profile;
+    res.detected        = 0;
+    res.expected        = 0;
+    res.false_positives = 0;
+
+    uint32_t packet_size    = profile.sampling_rate * PACKET_MS / 1000;
+    uint64_t num_samples    = 0;
+    double   ns             = 0;
+
+    for( auto & clip : clips )
+    {
+        double best_ns = 0;
+
+        for( uint32_t rr = 0; rr < repeats; ++rr )
+        {
+            dtmf::DtmfDetector detector( profile );
+            Collector collector;
+
+            detector.init_callback( & collector );
+
+            auto start = std::chrono::steady_clock::now();
+
+            for( size_t pos = 0; pos < clip.samples.size(); pos += packet_size )
+                detector.process( & clip.samples[pos], std::min<size_t>( packet_size, clip.samples.size() - pos ) );
+
+            double clip_ns = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count();
+
+            if( rr == 0 || clip_ns < best_ns )
+                best_ns = clip_ns;
+
+            if( rr == 0 )
+            {
+                uint32_t matches = get_matches( clip.digits, collector.digits );
+
+                res.detected        += matches;
+                res.expected        += clip.digits.size();
+                res.false_positives += collector.digits.size() - matches;
+            }
+        }
+
+        ns          += best_ns;
+        num_samples += clip.samples.size();
+    }
+
+    res.ns_per_frame    = ns * profile.frame_size / num_samples;
+    res.us_per_second   = ns / 1000 * profile.sampling_rate / num_samples;
+
+    return res;
+}
+
+static double get_detection_rate( const Result & r )
+{
+    return r.expected ? 100.0 * r.detected / r.expected : 100.0;
+}
+
+// true if a is at least as good as b in all respects and better in one,
+// CPU differences within CPU_TOLERANCE are ties
+static bool dominates( const Result & a, const Result & b )
+{
+    bool is_not_slower  = a.us_per_second <= b.us_per_second * ( 1 + CPU_TOLERANCE );
+    bool is_faster      = a.us_per_second < b.us_per_second * ( 1 - CPU_TOLERANCE );
+
+    bool is_not_worse   = a.detected >= b.detected && a.false_positives <= b.false_positives && is_not_slower;
+    bool is_better      = a.detected > b.detected || a.false_positives < b.false_positives || is_faster;
+
+    return is_not_worse && is_better;
+}
+
+static bool is_same( const dtmf::DtmfDetector::Profile & a, const dtmf::DtmfDetector::Profile & b )
+{
+    return a.sampling_rate == b.sampling_rate && a.frame_size == b.frame_size && a.power_threshold == b.power_threshold &&
+            a.dial_tones_to_others_tones == b.dial_tones_to_others_tones &&
+            a.dial_tones_to_others_dial_tones == b.dial_tones_to_others_dial_tones;
+}
+
+static void print_result( const Result & r )
+{
+    std::cout << std::setw( 6 ) << r.profile.frame_size
+            << std::setw( 7 ) << r.profile.power_threshold
+            << std::setw( 7 ) << r.profile.dial_tones_to_others_tones
+            << std::setw( 7 ) << r.profile.dial_tones_to_others_dial_tones
+            << std::setw( 9 ) << std::fixed << std::setprecision( 1 ) << get_detection_rate( r )
+            << std::setw( 7 ) << r.false_positives
+            << std::setw( 11 ) << std::setprecision( 0 ) << r.ns_per_frame
+            << std::setw( 9 ) << r.us_per_second << std::endl;
+}
+
+int main( int argc, char **argv )
+{
+    int32_t     rate        = 8000;
+    std::string dir         = "test-data";
+    std::string output;
+    uint32_t    repeats     = DEFAULT_REPEATS;
+
+    for( int ii = 1; ii < argc; ++ii )
+    {
+        if( strcmp( argv[ii], "-r" ) == 0 && ii + 1 < argc )
+            rate = atoi( argv[++ii] );
+        else if( strcmp( argv[ii], "-d" ) == 0 && ii + 1 < argc )
+            dir = argv[++ii];
+        else if( strcmp( argv[ii], "-n" ) == 0 && ii + 1 < argc )
+            repeats = atoi( argv[++ii] );
+        else if( strcmp( argv[ii], "-o" ) == 0 && ii + 1 < argc )
+            output = argv[++ii];
+        else
+        {
+            usage( argv[0] );
+            return 1;
+        }
+    }
+
+    if( dtmf::DtmfDetector::get_frame_size( rate ) == 0 || repeats == 0 )
+    {
+        usage( argv[0] );
+        return 1;
+    }
+
+    try
+    {
+        std::vector<Clip> clips;
+
+        // fixed seed, so that the runs are comparable
+        std::mt19937 rng( 1 );
+
+        load_recordings( dir, rate, clips );
+        generate_noisy( rng, rate, clips );
+        generate_talk_off( rng, rate, clips );
+
+        std::cout << "corpus: " << clips.size() << " clips" << std::endl;
+
+        const dtmf::DtmfDetector::Profile def_profile( rate );
+
+        // the default frame size is swept as well (it is not among the
+        // scaled ones at 44.1 KHz), so the default is timed in the sweep
+        std::vector<uint32_t> frame_sizes( 1, def_profile.frame_size );
+
+        for( auto frame_size : FRAME_SIZES_8KHZ )
+            frame_sizes.push_back( static_cast<uint32_t>( static_cast<uint64_t>( frame_size ) * rate / 8000 ) );
+
+        std::sort( frame_sizes.begin(), frame_sizes.end() );
+        frame_sizes.erase( std::unique( frame_sizes.begin(), frame_sizes.end() ), frame_sizes.end() );
+
+        std::vector<Result> results;
+
+        for( auto frame_size : frame_sizes )
+        {
+            dtmf::DtmfDetector::Profile profile( rate );
+
+            profile.frame_size = frame_size;
+
+            if( profile.frame_size > dtmf::DtmfDetector::get_max_frame_size( rate ) )
+                continue;
+
+            for( auto power : POWER_THRESHOLDS )
+            {
+                for( auto tones : TONES_RATIOS )
+                {
+                    for( auto dial_tones : DIAL_TONES_RATIOS )
+                    {
+                        profile.power_threshold                 = power;
+                        profile.dial_tones_to_others_tones      = tones;
+                        profile.dial_tones_to_others_dial_tones = dial_tones;
+
+                        results.push_back( evaluate( profile, clips, repeats ) );
+                    }
+                }
+            }
+        }
+
+        std::vector<Result> front;
+
+        for( auto & r : results )
+        {
+            bool is_dominated = false;
+
+            for( auto & other : results )
+            {
+                if( dominates( other, r ) )
+                {
+                    is_dominated = true;
+                    break;
+                }
+            }
+
+            if( is_dominated == false )
+                front.push_back( r );
+        }
+
+        // most accurate first
+        std::sort( front.begin(), front.end(), []( const Result & a, const Result & b )
+            {
+                if( a.detected != b.detected )
+                    return a.detected > b.detected;
+                if( a.false_positives != b.false_positives )
+                    return a.false_positives < b.false_positives;
+                return a.us_per_second < b.us_per_second;
+            } );
+
+        std::cout << results.size() << " settings, Pareto front:" << std::endl
+                << " frame  power  tones   dial  detect%     fp   ns/frame   us/sec" << std::endl;
+
+        for( auto & r : front )
+            print_result( r );
+
+        auto is_default = [&def_profile]( const Result & r ) { return is_same( r.profile, def_profile ); };
+
+        // the thresholds of the default are among the swept values
+        auto def = std::find_if( results.begin(), results.end(), is_default );
+
+        if( def != results.end() )
+        {
+            bool is_on_front = std::find_if( front.begin(), front.end(), is_default ) != front.end();
+
+            std::cout << "default" << ( is_on_front ? ", on the front:" : ", dominated:" ) << std::endl;
+            print_result( * def );
+        }
+
+        if( output.empty() == false )
+        {
+            std::ofstream os( output.c_str() );
+
+            os << "# written by dtmf_tune, " << results.size() << " settings, " << clips.size() << " clips\n"
+                    << "# Pareto front of detection rate, false positives and CPU, most accurate first\n";
+
+            for( size_t ii = 0; ii < front.size(); ++ii )
+            {
+                const Result & r = front[ii];
+
+                os << "\n# detection " << std::fixed << std::setprecision( 1 ) << get_detection_rate( r ) << "%, "
+                        << r.false_positives << " false positives, "
+                        << std::setprecision( 0 ) << r.ns_per_frame << " ns/frame, "
+                        << r.us_per_second << " us per second of audio\n";
+
+                dtmf::write_profile( os, std::to_string( ii + 1 ), r.profile );
+            }
+
+            if( os.fail() )
+                throw std::runtime_error( "cannot write " + output );
+
+            std::cout << "profiles written to " << output << std::endl;
+        }
+    }
+    catch( std::exception & e )
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -29,6 +29,7 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include "DtmfDetector.hpp"
 #include "IDtmfDetectorCallback.hpp"    // IDtmfDetectorCallback
+#include "Pipeline.hpp"                 // Pipeline
 
 
 // The size of the buffer we use for reading & processing the audio samples.
@@ -96,11 +97,13 @@ int main( int argc, char **argv )
     Callback callback;
 
     std::vector<char> cbuf(BUFLEN * 2);
-    std::vector<short> sbuf( BUFLEN );
     dtmf::DtmfDetector detector( header.get_samples_per_sec() );
 
     detector.init_callback( & callback );
 
+    // 16-bit little endian samples, analysed in place on little endian hosts
+    dtmf::Pipeline<dtmf::Decode<dtmf::Pcm16le>, dtmf::Detect> pipeline( detector );
+
     auto data_size = header.get_data_size();
 
     for( auto i = 0; i < data_size; i += BUFLEN*2 )
@@ -109,13 +112,7 @@ int main( int argc, char **argv )
 
         header.get_samples( i, BUFLEN * 2, cbuf );
 
-        // copy char data into short array
-        for( int j = 0; j < BUFLEN; ++j )
-        {
-            sbuf[j] = (short)cbuf[j * 2 ] + ( (short)cbuf[j * 2 + 1] << 8 );
-        }
-
-        detector.process( &sbuf[0], sbuf.size() );
+        pipeline.push( reinterpret_cast<const uint8_t *>( cbuf.data() ), cbuf.size() );
     }
 
     std::cout << std::endl;
@@ -0,0 +1,272 @@
+/*
+
+Stand-in for a media process: writes generated DTMF digits into the
+shared memory region of dtmf_daemon and prints the detected events.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>                    // std::min
+#include <cstdlib>                      // atoi
+#include <cstring>                      // strcmp
+#include <ctime>                        // clock_nanosleep
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DtmfGenerator.hpp"            // DtmfGenerator
+#include "ShmTransport.hpp"             // shm::Mapping
+
+// Size of a packet written at once, ms.
+#define PACKET_MS       20
+// Time to wait for the daemon to close the streams, ms.
+#define CLOSE_TIMEOUT_MS 5000
+
+static void usage( const char * prog )
+{
+    std::cerr << "usage: " << prog << " [-n region_name] [-r sampling_rate] [-s streams] [-f] [-i silence_ms] digits" << std::endl
+            << "  -f    don't pace the audio in real time" << std::endl
+            << "  -i    silence before the digits, the stream becomes idle after 2 s" << std::endl;
+}
+
+static void sleep_ms( uint32_t ms )
+{
+    struct timespec ts;
+
+    ts.tv_sec   = ms / 1000;
+    ts.tv_nsec  = ( ms % 1000 ) * 1000000L;
+
+    nanosleep( & ts, nullptr );
+}
+
+// Reads the events of the stream, returns the number of events.
+static uint32_t read_events( uint32_t id, dtmf::shm::Stream * stream, int32_t sampling_rate, std::string & detected )
+{
+    uint32_t                    res = 0;
+    const dtmf::shm::Event      * events;
+    uint32_t                    size;
+
+    while( ( size = dtmf::shm::peek( stream->events, & events ) ) > 0 )
+    {
+        for( uint32_t ii = 0; ii < size; ++ii )
+        {
+            char c = dtmf::DtmfGenerator::to_char( static_cast<dtmf::tone_e>( events[ii].tone ) );
+
+            std::cout << "stream " << id << ": '" << c << "' at " << events[ii].position * 1000 / sampling_rate << " ms" << std::endl;
+
+            detected += c;
+        }
+
+        dtmf::shm::consume( stream->events, size );
+
+        res += size;
+    }
+
+    return res;
+}
+
+// Closes the streams and waits for the daemon to process their audio,
+// the closed streams are freed.  Returns the number of streams left open.
+static uint32_t close_streams( dtmf::shm::Region * region, const std::vector<dtmf::shm::Stream*> & streams, int32_t sampling_rate, std::vector<std::string> & detected )
+{
+    uint32_t num_streams = streams.size();
+
+    for( auto stream : streams )
+        dtmf::shm::close_stream( stream );
+
+    dtmf::shm::notify_daemon( region );
+
+    // the daemon closes the streams when all audio is processed
+    uint32_t num_open = num_streams;
+
+    for( uint32_t waited = 0; waited < CLOSE_TIMEOUT_MS && num_open > 0; waited += 10 )
+    {
+        uint32_t seen = region->event_doorbell.load();
+
+        num_open = 0;
+
+        for( uint32_t ii = 0; ii < num_streams; ++ii )
+        {
+            if( streams[ii]->state.load() != static_cast<uint32_t>( dtmf::shm::stream_state_e::CLOSED ) )
+                ++num_open;
+        }
+
+        for( uint32_t ii = 0; ii < num_streams; ++ii )
+            read_events( ii, streams[ii], sampling_rate, detected[ii] );
+
+        if( num_open > 0 )
+            dtmf::shm::wait( region->event_doorbell, seen, 10 );
+    }
+
+    // the events written before CLOSED are read above, the slots can be reused
+    for( auto stream : streams )
+    {
+        if( stream->state.load() == static_cast<uint32_t>( dtmf::shm::stream_state_e::CLOSED ) )
+            dtmf::shm::free_stream( stream );
+    }
+
+    return num_open;
+}
+
+int main( int argc, char **argv )
+{
+    std::string name        = "dtmf_detector";
+    int32_t     rate        = 8000;
+    uint32_t    num_streams = 1;
+    bool        is_paced    = true;
+    uint32_t    silence_ms  = 0;
+    std::string digits;
+
+    for( int ii = 1; ii < argc; ++ii )
+    {
+        if( strcmp( argv[ii], "-n" ) == 0 && ii + 1 < argc )
+            name = argv[++ii];
+        else if( strcmp( argv[ii], "-r" ) == 0 && ii + 1 < argc )
+            rate = atoi( argv[++ii] );
+        else if( strcmp( argv[ii], "-s" ) == 0 && ii + 1 < argc )
+            num_streams = atoi( argv[++ii] );
+        else if( strcmp( argv[ii], "-f" ) == 0 )
+            is_paced = false;
+        else if( strcmp( argv[ii], "-i" ) == 0 && ii + 1 < argc )
+            silence_ms = atoi( argv[++ii] );
+        else if( digits.empty() && argv[ii][0] != '-' )
+            digits = argv[ii];
+        else
+        {
+            usage( argv[0] );
+            return 1;
+        }
+    }
+
+    if( digits.empty() || num_streams == 0 )
+    {
+        usage( argv[0] );
+        return 1;
+    }
+
+    std::vector<int16_t> samples;
+
+    try
+    {
+        dtmf::DtmfGenerator generator( rate );
+
+        generator.generate_silence( silence_ms, samples );
+        generator.generate( digits, samples );
+        generator.generate_silence( 500, samples );
+    }
+    catch( std::exception & e )
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        dtmf::shm::Mapping mapping( name, false );
+
+        dtmf::shm::Region * region = mapping.get_region();
+
+        if( region->is_daemon_running.load() == 0 )
+        {
+            std::cerr << "error: daemon is not running" << std::endl;
+            return 1;
+        }
+
+        std::vector<dtmf::shm::Stream*> streams;
+
+        for( uint32_t ii = 0; ii < num_streams; ++ii )
+        {
+            dtmf::shm::Stream * stream = dtmf::shm::open_stream( region, rate );
+
+            if( stream == nullptr )
+            {
+                std::cerr << "error: no free streams" << std::endl;
+
+                std::vector<std::string> detected( streams.size() );
+
+                close_streams( region, streams, rate, detected );
+
+                return 1;
+            }
+
+            streams.push_back( stream );
+        }
+
+        std::vector<std::string> detected( num_streams );
+
+        uint32_t packet_size = rate * PACKET_MS / 1000;
+
+        bool is_rejected = false;
+
+        for( size_t pos = 0; pos < samples.size() && is_rejected == false; pos += packet_size )
+        {
+            uint32_t size = std::min<size_t>( packet_size, samples.size() - pos );
+
+            for( uint32_t ii = 0; ii < num_streams; ++ii )
+            {
+                // the daemon closes a stream it cannot handle
+                if( streams[ii]->state.load() == static_cast<uint32_t>( dtmf::shm::stream_state_e::CLOSED ) )
+                {
+                    std::cerr << "error: stream " << ii << " rejected by the daemon" << std::endl;
+                    is_rejected = true;
+                    break;
+                }
+
+                uint32_t written = 0;
+
+                while( ( written += dtmf::shm::write( streams[ii]->audio, & samples[pos + written], size - written ) ) < size )
+                {
+                    // ring is full, let the daemon catch up
+                    dtmf::shm::notify_daemon( region );
+                    sleep_ms( 1 );
+                }
+
+                dtmf::shm::notify_daemon( region, streams[ii], & samples[pos], size );
+
+                read_events( ii, streams[ii], rate, detected[ii] );
+            }
+
+            if( is_paced )
+                sleep_ms( PACKET_MS );
+        }
+
+        uint32_t num_open = close_streams( region, streams, rate, detected );
+
+        if( is_rejected )
+            return 1;
+
+        if( num_open > 0 )
+            std::cerr << "error: the daemon did not close " << num_open << " streams" << std::endl;
+
+        bool is_ok = num_open == 0;
+
+        for( uint32_t ii = 0; ii < num_streams; ++ii )
+        {
+            std::cout << "stream " << ii << ": sent " << digits << ", detected " << detected[ii] << std::endl;
+
+            if( detected[ii] != digits )
+                is_ok = false;
+        }
+
+        return is_ok ? 0 : 2;
+    }
+    catch( std::exception & e )
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,98 @@
+/*
+
+Check of the C interface: compiled as C, linked with the shared library.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "dtmf_detector.h"
+
+#include <math.h>       /* sin */
+#include <stdio.h>      /* printf */
+#include <stdlib.h>     /* malloc */
+
+#define RATE        8000
+#define TONE_MS     100
+#define PAUSE_MS    100
+
+/* Writes the digit 5 (770 + 1336 Hz) followed by a pause. */
+static uint32_t generate( int16_t * samples )
+{
+    const double PI = 3.14159265358979323846;
+
+    uint32_t tone_size  = RATE * TONE_MS / 1000;
+    uint32_t size       = tone_size + RATE * PAUSE_MS / 1000;
+    uint32_t i;
+
+    for( i = 0; i < size; ++i )
+    {
+        double t = (double)i / RATE;
+
+        samples[i] = ( i < tone_size ) ? (int16_t)( 8000 * ( sin( 2 * PI * 770 * t ) + sin( 2 * PI * 1336 * t ) ) ) : 0;
+    }
+
+    return size;
+}
+
+int main( void )
+{
+    int16_t         samples[RATE * ( TONE_MS + PAUSE_MS ) / 1000];
+    dtmf_event_t    events[16];
+
+    size_t          size    = dtmf_state_size( RATE );
+    void            * memory;
+    dtmf_state_t    * state;
+    uint32_t        count;
+    uint32_t        num_events;
+
+    if( size == 0 || dtmf_frame_size( RATE ) == 0 )
+    {
+        printf( "FAILED: rate %d is not supported\n", RATE );
+        return 1;
+    }
+
+    if( dtmf_state_size( 1234 ) != 0 || dtmf_init( NULL, size, RATE ) != NULL )
+    {
+        printf( "FAILED: invalid arguments are accepted\n" );
+        return 1;
+    }
+
+    memory  = malloc( size );
+    state   = dtmf_init( memory, size, RATE );
+
+    if( state == NULL )
+    {
+        printf( "FAILED: dtmf_init\n" );
+        free( memory );
+        return 1;
+    }
+
+    count       = generate( samples );
+    num_events  = dtmf_process( state, samples, count, events, sizeof( events ) / sizeof( events[0] ) );
+
+    free( memory );
+
+    if( num_events != 1 || events[0].tone != DTMF_TONE_5 || events[0].position >= count )
+    {
+        printf( "FAILED: %u events, expected DTMF_TONE_5\n", num_events );
+        return 1;
+    }
+
+    printf( "OK\n" );
+
+    return 0;
+}
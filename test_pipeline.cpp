@@ -0,0 +1,210 @@
+/*
+
+Check of the pipeline: each sample format, with and without decimation.
+
+Copyright (C) 2016 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>    // std::min
+#include <cmath>        // sin
+#include <cstdlib>      // abs
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DtmfDetector.hpp"             // DtmfDetector
+#include "IDtmfDetectorCallback.hpp"    // IDtmfDetectorCallback
+#include "Pipeline.hpp"                 // Pipeline
+
+#define RATE        8000
+#define TONE_MS     100
+#define PAUSE_MS    100
+
+static const char DIGITS[] = "159#";
+
+class Callback: public dtmf::IDtmfDetectorCallback
+{
+public:
+    virtual void on_detect( dtmf::tone_e tone )
+    {
+        detected += "0123456789ABCD*#"[static_cast<int>( tone )];
+    }
+
+    std::string detected;
+};
+
+// Samples of DIGITS at RATE * factor, each tone followed by a pause.
+static std::vector<int16_t> generate( uint32_t factor )
+{
+    static const double LOW[]   = { 697.0, 770.0, 852.0, 941.0 };
+    static const double HIGH[]  = { 1209.0, 1336.0, 1477.0, 1633.0 };
+
+    // row and column of the digits of DIGITS
+    static const unsigned ROW[]     = { 0, 1, 2, 3 };
+    static const unsigned COLUMN[]  = { 0, 1, 2, 2 };
+
+    const double PI = 3.14159265358979323846;
+
+    uint32_t rate       = RATE * factor;
+    uint32_t tone_size  = rate * TONE_MS / 1000;
+    uint32_t pause_size = rate * PAUSE_MS / 1000;
+
+    std::vector<int16_t> res;
+
+    for( unsigned ii = 0; ii < sizeof( DIGITS ) - 1; ++ii )
+    {
+        for( uint32_t jj = 0; jj < tone_size; ++jj )
+        {
+            double t = static_cast<double>( jj ) / rate;
+
+            res.push_back( static_cast<int16_t>( 8000 * ( sin( 2 * PI * LOW[ROW[ii]] * t ) + sin( 2 * PI * HIGH[COLUMN[ii]] * t ) ) ) );
+        }
+
+        res.insert( res.end(), pause_size, 0 );
+    }
+
+    return res;
+}
+
+// Encodes a sample as the byte sequence which decodes closest to it.
+template <class Format>
+static void encode( int16_t sample, uint8_t * p )
+{
+    if( Format::BYTES == 2 )
+    {
+        // the order of the bytes is found by decoding 0x0100
+        uint8_t probe[2] = { 1, 0 };
+
+        bool is_le = Format::decode( probe ) == 1;
+
+        p[is_le ? 0 : 1] = static_cast<uint8_t>( sample & 0xFF );
+        p[is_le ? 1 : 0] = static_cast<uint8_t>( ( sample >> 8 ) & 0xFF );
+
+        return;
+    }
+
+    int32_t best = -1;
+
+    for( int32_t ii = 0; ii < 256; ++ii )
+    {
+        uint8_t b = static_cast<uint8_t>( ii );
+
+        uint8_t c = static_cast<uint8_t>( best );
+
+        if( best < 0 || abs( Format::decode( & b ) - sample ) < abs( Format::decode( & c ) - sample ) )
+            best = ii;
+    }
+
+    p[0] = static_cast<uint8_t>( best );
+}
+
+// Pushes the data in chunks of odd sizes, so that samples are split
+// between the calls, returns true if DIGITS are detected.
+template <class P, class T>
+static bool run( const std::string & name, const T * data, size_t size )
+{
+    dtmf::DtmfDetector  detector( RATE );
+    Callback            callback;
+
+    detector.init_callback( & callback );
+
+    P pipeline( detector );
+
+    for( size_t pos = 0; pos < size; )
+    {
+        uint32_t chunk = std::min<size_t>( 77 + pos % 101, size - pos );
+
+        pipeline.push( data + pos, chunk );
+
+        pos += chunk;
+    }
+
+    pipeline.flush();
+
+    if( callback.detected != DIGITS )
+    {
+        std::cout << "FAILED: " << name << ", detected '" << callback.detected << "', expected '" << DIGITS << "'" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Runs a pipeline decoding Format at RATE * factor, the data are pushed
+// from an aligned and from an odd address (the slow path of Pcm16le).
+template <class P, class Format>
+static bool check( const std::string & name, uint32_t factor )
+{
+    std::vector<int16_t> samples = generate( factor );
+
+    // one spare byte in front of the odd copy
+    std::vector<uint8_t> buffer( samples.size() * Format::BYTES + 1 );
+
+    for( size_t ii = 0; ii < samples.size(); ++ii )
+        encode<Format>( samples[ii], & buffer[1 + ii * Format::BYTES] );
+
+    std::vector<uint8_t> data( buffer.begin() + 1, buffer.end() );
+
+    return run<P>( name, data.data(), data.size() ) && run<P>( name + ", odd address", buffer.data() + 1, data.size() );
+}
+
+template <class Format>
+static bool check_format( const std::string & name )
+{
+    using dtmf::Pipeline;
+    using dtmf::Decode;
+    using dtmf::Decimate;
+    using dtmf::Detect;
+
+    bool is_ok = check<Pipeline<Decode<Format>, Detect>, Format>( name, 1 );
+
+    is_ok = check<Pipeline<Decode<Format>, Decimate<2>, Detect>, Format>( name + ", Decimate<2>", 2 ) && is_ok;
+    is_ok = check<Pipeline<Decode<Format>, Decimate<3>, Detect>, Format>( name + ", Decimate<3>", 3 ) && is_ok;
+
+    return is_ok;
+}
+
+int main()
+{
+    bool is_ok = true;
+
+    std::vector<int16_t> samples = generate( 1 );
+
+    is_ok = run<dtmf::Pipeline<dtmf::Detect>>( "Detect", samples.data(), samples.size() ) && is_ok;
+
+    samples = generate( 2 );
+
+    is_ok = run<dtmf::Pipeline<dtmf::Decimate<2>, dtmf::Detect>>( "Decimate<2>", samples.data(), samples.size() ) && is_ok;
+
+    samples = generate( 3 );
+
+    is_ok = run<dtmf::Pipeline<dtmf::Decimate<3>, dtmf::Detect>>( "Decimate<3>", samples.data(), samples.size() ) && is_ok;
+
+    is_ok = check_format<dtmf::Pcm8Unsigned>( "Pcm8Unsigned" ) && is_ok;
+    is_ok = check_format<dtmf::Pcm8Signed>( "Pcm8Signed" ) && is_ok;
+    is_ok = check_format<dtmf::Pcm16le>( "Pcm16le" ) && is_ok;
+    is_ok = check_format<dtmf::Pcm16be>( "Pcm16be" ) && is_ok;
+    is_ok = check_format<dtmf::Ulaw>( "Ulaw" ) && is_ok;
+    is_ok = check_format<dtmf::Alaw>( "Alaw" ) && is_ok;
+
+    if( is_ok == false )
+        return 1;
+
+    std::cout << "OK" << std::endl;
+
+    return 0;
+}